@@ -0,0 +1,180 @@
+#include "binary_reader.h"
+#include "gzip_stream.h"
+
+#include <google/protobuf/util/delimited_message_util.h>
+
+#include <stdexcept>
+
+using namespace std::literals;
+
+BinaryReader::BinaryReader(std::istream& input)
+    : input_(&input)
+{
+    if (!google::protobuf::util::ParseDelimitedFromZeroCopyStream(&serialization_settings_, &input_, nullptr)) {
+        throw std::runtime_error("Binary requests must start with SerializationSettings"s);
+    }
+}
+
+const proto_requests::SerializationSettings& BinaryReader::GetSerializationSettings() const {
+    return serialization_settings_;
+}
+
+void BinaryReader::ProcessStatRequests(const RequestHandler& rh, std::ostream& output) {
+    google::protobuf::io::OstreamOutputStream output_stream(&output);
+    proto_requests::StatRequest request;
+    proto_requests::StatResponse response;
+    bool clean_eof = false;
+    // Разбор сливает поля с уже заполненным сообщением, поэтому запрос очищается перед каждым чтением
+    for (request.Clear(); google::protobuf::util::ParseDelimitedFromZeroCopyStream(&request, &input_, &clean_eof); request.Clear()) {
+        response.Clear();
+        ProcessRequest(request, rh, response);
+        if (!google::protobuf::util::SerializeDelimitedToZeroCopyStream(response, &output_stream)) {
+            throw std::runtime_error("Error writing binary response"s);
+        }
+    }
+    if (!clean_eof) {
+        throw std::runtime_error("Truncated binary request"s);
+    }
+}
+
+void BinaryReader::ProcessRequest(const proto_requests::StatRequest& request, const RequestHandler& rh, proto_requests::StatResponse& response) const {
+    response.set_request_id(request.id());
+    bool is_found = false;
+    switch (request.request_case()) {
+    case proto_requests::StatRequest::kBus:
+        is_found = PrintRoute(request.bus(), rh, response);
+        break;
+    case proto_requests::StatRequest::kStop:
+        is_found = PrintStop(request.stop(), rh, response);
+        break;
+    case proto_requests::StatRequest::kMap:
+        is_found = PrintMap(request.map(), rh, response);
+        break;
+    case proto_requests::StatRequest::kRoute:
+        is_found = PrintRouting(request.route(), rh, response);
+        break;
+    case proto_requests::StatRequest::kRouteMap:
+        is_found = PrintRouteMap(request.route_map(), rh, response);
+        break;
+    case proto_requests::StatRequest::kTile:
+        is_found = PrintTile(request.tile(), rh, response);
+        break;
+    case proto_requests::StatRequest::REQUEST_NOT_SET:
+        response.set_error_message("unknown request type"s);
+        return;
+    }
+    if (!is_found) {
+        response.set_error_message("not found"s);
+    }
+    else if (request.gzip_map() && response.has_map()) {
+        auto& map_response = *response.mutable_map();
+        // Карта всей сети сжата заранее, остальные сжимаются здесь
+        if (request.has_map() && !request.map().has_bbox()) {
+            map_response.set_map_gzip(std::string(rh.GetMapSvgGzip()));
+        }
+        else {
+            map_response.set_map_gzip(gzip::Compress(map_response.map()));
+        }
+        map_response.clear_map();
+    }
+}
+
+bool BinaryReader::PrintRoute(const proto_requests::BusRequest& request, const RequestHandler& rh, proto_requests::StatResponse& response) const {
+    const transport::Bus* bus = rh.FindBusById(request.bus_id());
+    if (!bus) {
+        return false;
+    }
+    const auto route_info = rh.GetBusStat(bus->number);
+    auto& bus_response = *response.mutable_bus();
+    bus_response.set_curvature(route_info->curvature);
+    bus_response.set_route_length(route_info->route_length);
+    bus_response.set_stop_count(static_cast<int>(route_info->stops_count));
+    bus_response.set_unique_stop_count(static_cast<int>(route_info->unique_stops_count));
+    return true;
+}
+
+bool BinaryReader::PrintStop(const proto_requests::StopRequest& request, const RequestHandler& rh, proto_requests::StatResponse& response) const {
+    const transport::Stop* stop = rh.FindStopById(request.stop_id());
+    if (!stop) {
+        return false;
+    }
+    auto& stop_response = *response.mutable_stop();
+    for (const auto& bus_number : stop->buses_by_stop) {
+        stop_response.add_bus_ids(static_cast<uint32_t>(*rh.GetBusId(bus_number)));
+    }
+    return true;
+}
+
+bool BinaryReader::PrintMap(const proto_requests::MapRequest& request, const RequestHandler& rh, proto_requests::StatResponse& response) const {
+    if (!request.has_bbox()) {
+        response.mutable_map()->set_map(std::string(rh.GetMapSvg()));
+        return true;
+    }
+    renderer::MapView view;
+    view.box.min = { request.bbox().min_lat(), request.bbox().min_lng() };
+    view.box.max = { request.bbox().max_lat(), request.bbox().max_lng() };
+    if (request.width() > 0.0) {
+        view.width = request.width();
+    }
+    if (request.height() > 0.0) {
+        view.height = request.height();
+    }
+    format::Buffer svg_text;
+    rh.RenderMap(view).Render(svg_text);
+    response.mutable_map()->set_map(std::string(svg_text.View()));
+    return true;
+}
+
+bool BinaryReader::PrintRouteMap(const proto_requests::RouteRequest& request, const RequestHandler& rh, proto_requests::StatResponse& response) const {
+    const transport::Stop* from = rh.FindStopById(request.from_stop_id());
+    const transport::Stop* to = rh.FindStopById(request.to_stop_id());
+    if (!from || !to) {
+        return false;
+    }
+    const auto route_map = rh.RenderRouteMap(from->name, to->name);
+    if (!route_map) {
+        return false;
+    }
+    format::Buffer svg_text;
+    route_map->Render(svg_text);
+    response.mutable_map()->set_map(std::string(svg_text.View()));
+    return true;
+}
+
+bool BinaryReader::PrintTile(const proto_requests::TileRequest& request, const RequestHandler& rh, proto_requests::StatResponse& response) const {
+    const std::string* tile = rh.GetTile(request.zoom(), request.x(), request.y());
+    if (!tile) {
+        return false;
+    }
+    response.mutable_map()->set_map(*tile);
+    return true;
+}
+
+bool BinaryReader::PrintRouting(const proto_requests::RouteRequest& request, const RequestHandler& rh, proto_requests::StatResponse& response) const {
+    const transport::Stop* from = rh.FindStopById(request.from_stop_id());
+    const transport::Stop* to = rh.FindStopById(request.to_stop_id());
+    if (!from || !to) {
+        return false;
+    }
+    const auto routing = rh.GetOptimalRoute(from->name, to->name);
+    if (!routing) {
+        return false;
+    }
+    auto& route_response = *response.mutable_route();
+    double total_time = 0.0;
+    for (const auto& edge_id : routing->edges) {
+        const auto& edge = rh.GetRouterGraph().GetEdge(edge_id);
+        auto& item = *route_response.add_items();
+        if (edge.quality == 0) {
+            item.set_wait_stop_id(static_cast<uint32_t>(*rh.GetStopId(edge.name)));
+        }
+        else {
+            item.set_bus_id(static_cast<uint32_t>(*rh.GetBusId(edge.name)));
+            item.set_span_count(static_cast<int>(edge.quality));
+        }
+        item.set_time(edge.weight);
+        total_time += edge.weight;
+    }
+    route_response.set_total_time(total_time);
+    return true;
+}
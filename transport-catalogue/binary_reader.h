@@ -0,0 +1,37 @@
+#pragma once
+
+#include "request_handler.h"
+#include "stat_requests.pb.h"
+
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+
+#include <iostream>
+
+/*
+    * Двоичный аналог JsonReader для stat_requests (формат описан в stat_requests.proto).
+    * Настройки сериализации читаются в конструкторе, запросы — по одному в ProcessStatRequests,
+    * поэтому память не зависит от числа запросов. Ответы вычисляются тем же RequestHandler,
+    * что и для JSON, но остановки и маршруты в них задаются номерами, а не названиями
+    */
+class BinaryReader {
+public:
+    // Бросает std::runtime_error, если вход не начинается с SerializationSettings
+    explicit BinaryReader(std::istream& input);
+
+    const proto_requests::SerializationSettings& GetSerializationSettings() const;
+
+    // Отвечает на запросы до конца входа. Бросает std::runtime_error на оборванном сообщении
+    void ProcessStatRequests(const RequestHandler& rh, std::ostream& output);
+    void ProcessRequest(const proto_requests::StatRequest& request, const RequestHandler& rh, proto_requests::StatResponse& response) const;
+
+private:
+    google::protobuf::io::IstreamInputStream input_;
+    proto_requests::SerializationSettings serialization_settings_;
+
+    bool PrintRoute(const proto_requests::BusRequest& request, const RequestHandler& rh, proto_requests::StatResponse& response) const;
+    bool PrintStop(const proto_requests::StopRequest& request, const RequestHandler& rh, proto_requests::StatResponse& response) const;
+    bool PrintMap(const proto_requests::MapRequest& request, const RequestHandler& rh, proto_requests::StatResponse& response) const;
+    bool PrintRouteMap(const proto_requests::RouteRequest& request, const RequestHandler& rh, proto_requests::StatResponse& response) const;
+    bool PrintTile(const proto_requests::TileRequest& request, const RequestHandler& rh, proto_requests::StatResponse& response) const;
+    bool PrintRouting(const proto_requests::RouteRequest& request, const RequestHandler& rh, proto_requests::StatResponse& response) const;
+};
@@ -2,6 +2,7 @@
 
 #include "geo.h"
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <set>
@@ -13,6 +14,8 @@ struct Stop {
     std::string name;
     geo::Coordinates coordinates;
     std::set<std::string> buses_by_stop;
+    // Порядковый номер остановки в справочнике, индекс в массивах координат Catalogue
+    size_t id = 0;
 };
 
 struct Bus {
@@ -21,6 +24,43 @@ struct Bus {
     bool is_circle;
 };
 
+// Плоское (SoA) представление остановок и маршрутов для горячих циклов:
+// рендеринга, статистики и построения графа.
+// Массивы остановок индексируются Stop::id. Маршруты пронумерованы в порядке возрастания
+// названий, остановки маршрута b лежат в bus_stop_ids[bus_offsets[b] .. bus_offsets[b + 1])
+struct RouteGeometry {
+    std::vector<const Stop*> stops;
+    std::vector<double> stop_lat;
+    std::vector<double> stop_lng;
+    std::vector<uint8_t> stop_on_route;
+    // Идентификаторы остановок в порядке возрастания названий и позиция каждой остановки в этом порядке
+    std::vector<size_t> sorted_stop_ids;
+    std::vector<size_t> stop_name_ranks;
+
+    std::vector<const Bus*> buses;
+    std::vector<size_t> bus_offsets;
+    std::vector<size_t> bus_stop_ids;
+    std::vector<uint8_t> bus_is_circle;
+    // Число маршрутов с остановками перед данным: по нему маршрутам по кругу раздаются цвета палитры
+    std::vector<size_t> bus_color_ranks;
+
+    size_t BusCount() const {
+        return buses.size();
+    }
+    size_t BusStopsCount(size_t bus) const {
+        return bus_offsets[bus + 1] - bus_offsets[bus];
+    }
+    const size_t* BusStopsBegin(size_t bus) const {
+        return bus_stop_ids.data() + bus_offsets[bus];
+    }
+    const size_t* BusStopsEnd(size_t bus) const {
+        return bus_stop_ids.data() + bus_offsets[bus + 1];
+    }
+    geo::Coordinates StopCoordinates(size_t stop) const {
+        return { stop_lat[stop], stop_lng[stop] };
+    }
+};
+
 struct BusStat {
     size_t stops_count;
     size_t unique_stops_count;
@@ -0,0 +1,114 @@
+#include "format.h"
+
+#include <algorithm>
+#include <charconv>
+#include <limits>
+
+namespace format {
+
+namespace {
+
+constexpr int kMaxFixedPrecision = 100;
+
+template <typename... Args>
+void AppendChars(std::string& out, Args... args) {
+    char chars[64];
+    if (const auto result = std::to_chars(chars, chars + sizeof(chars), args...); result.ec == std::errc{}) {
+        out.append(chars, result.ptr);
+        return;
+    }
+    // Большие числа в формате FIXED не помещаются в буфер на стеке
+    std::string long_chars(std::numeric_limits<double>::max_exponent10 + kMaxFixedPrecision + 3, '\0');
+    const auto result = std::to_chars(long_chars.data(), long_chars.data() + long_chars.size(), args...);
+    out.append(long_chars.data(), result.ptr);
+}
+
+}  // namespace
+
+std::optional<DoubleStyle> ParseDoubleStyle(std::string_view text) {
+    using namespace std::literals;
+
+    if (text == "compatible"sv) {
+        return DoubleStyle{ DoubleFormat::COMPATIBLE };
+    }
+    if (text == "shortest"sv) {
+        return DoubleStyle{ DoubleFormat::SHORTEST };
+    }
+    constexpr std::string_view fixed_prefix = "fixed:"sv;
+    if (text.substr(0, fixed_prefix.size()) != fixed_prefix) {
+        return std::nullopt;
+    }
+    text.remove_prefix(fixed_prefix.size());
+    int precision = 0;
+    const auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), precision);
+    if (ec != std::errc{} || ptr != text.data() + text.size() || precision < 0 || precision > kMaxFixedPrecision) {
+        return std::nullopt;
+    }
+    return DoubleStyle{ DoubleFormat::FIXED, precision };
+}
+
+void AppendInt(std::string& out, long long value) {
+    AppendChars(out, value);
+}
+
+void AppendDouble(std::string& out, double value, DoubleStyle style) {
+    switch (style.format) {
+    case DoubleFormat::COMPATIBLE:
+        // Общий формат с точностью 6 — это %g, которым std::ostream выводит double по умолчанию
+        AppendChars(out, value, std::chars_format::general, 6);
+        break;
+    case DoubleFormat::SHORTEST:
+        AppendChars(out, value);
+        break;
+    case DoubleFormat::FIXED:
+        AppendChars(out, value, std::chars_format::fixed, std::clamp(style.precision, 0, kMaxFixedPrecision));
+        break;
+    }
+}
+
+Buffer::Buffer(DoubleStyle style)
+    : style_(style) {
+}
+
+DoubleStyle Buffer::GetDoubleStyle() const {
+    return style_;
+}
+
+void Buffer::SetDoubleStyle(DoubleStyle style) {
+    style_ = style;
+}
+
+Buffer& Buffer::operator<<(std::string_view value) {
+    data_ += value;
+    return *this;
+}
+
+Buffer& Buffer::operator<<(char value) {
+    data_ += value;
+    return *this;
+}
+
+Buffer& Buffer::operator<<(int value) {
+    AppendInt(data_, value);
+    return *this;
+}
+
+Buffer& Buffer::operator<<(unsigned value) {
+    AppendInt(data_, value);
+    return *this;
+}
+
+Buffer& Buffer::operator<<(double value) {
+    AppendDouble(data_, value, style_);
+    return *this;
+}
+
+std::string_view Buffer::View() const {
+    return data_;
+}
+
+void Buffer::Clear() {
+    data_.clear();
+}
+
+} // namespace format
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace format {
+
+// Способ вывода чисел с плавающей точкой
+enum class DoubleFormat {
+    // Как std::ostream с настройками по умолчанию: общий формат, 6 значащих цифр.
+    // Вывод побитово совпадает с выводом через потоки
+    COMPATIBLE,
+    // Кратчайшая запись, из которой читается обратно то же самое число
+    SHORTEST,
+    // Фиксированное количество знаков после точки
+    FIXED,
+};
+
+struct DoubleStyle {
+    DoubleFormat format = DoubleFormat::COMPATIBLE;
+    // Количество знаков после точки для FIXED, от 0 до 100
+    int precision = 6;
+};
+
+// Разбирает запись стиля из настроек: "compatible", "shortest" или "fixed:N", где N — количество знаков
+// после точки. На неизвестную запись возвращает nullopt
+std::optional<DoubleStyle> ParseDoubleStyle(std::string_view text);
+
+// Дописывают число в конец строки через std::to_chars, минуя локаль и состояние потока
+void AppendInt(std::string& out, long long value);
+void AppendDouble(std::string& out, double value, DoubleStyle style = {});
+
+// Растущий символьный буфер с операторами вывода, как у std::ostream.
+// Числа форматируются через AppendInt и AppendDouble
+class Buffer {
+public:
+    Buffer() = default;
+    explicit Buffer(DoubleStyle style);
+
+    // Стиль, которым выводятся следующие числа double
+    DoubleStyle GetDoubleStyle() const;
+    void SetDoubleStyle(DoubleStyle style);
+
+    Buffer& operator<<(std::string_view value);
+    Buffer& operator<<(char value);
+    Buffer& operator<<(int value);
+    Buffer& operator<<(unsigned value);
+    Buffer& operator<<(double value);
+
+    std::string_view View() const;
+    void Clear();
+
+private:
+    std::string data_;
+    DoubleStyle style_;
+};
+
+} // namespace format
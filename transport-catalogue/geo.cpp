@@ -2,10 +2,214 @@
 
 #include "geo.h"
 
+#include <algorithm>
 #include <cmath>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace geo {
 
+namespace {
+
+constexpr double kDegToRad = M_PI / 180.;
+constexpr double kEarthRadius = 6371000;
+constexpr double kTwoPi = 2 * M_PI;
+constexpr double kInvTwoPi = 1 / kTwoPi;
+constexpr size_t kBlockSize = 256;
+
+// Ряд Тейлора для cos(x) до x^22 включительно: на [-pi, pi] погрешность меньше 2e-12,
+// а на [-pi/2, pi/2], где лежат широты, — меньше 1e-19
+constexpr double kCosCoeffs[] = {
+    1.0,
+    -1.0 / 2,
+    1.0 / 24,
+    -1.0 / 720,
+    1.0 / 40320,
+    -1.0 / 3628800,
+    1.0 / 479001600,
+    -1.0 / 87178291200.,
+    1.0 / 20922789888000.,
+    -1.0 / 6402373705728000.,
+    1.0 / 2432902008176640000.,
+    -1.0 / 1124000727777607680000.,
+};
+constexpr int kCosDegree = sizeof(kCosCoeffs) / sizeof(kCosCoeffs[0]) - 1;
+
+// Ряд Тейлора для sin(x) / x до x^20 включительно: на [-pi/2, pi/2] погрешность меньше 1e-18.
+// Считать синус широты через cos(pi/2 - x) нельзя: для близких точек аргумент acos
+// близок к 1, и погрешность синуса многократно усиливается
+constexpr double kSinCoeffs[] = {
+    1.0,
+    -1.0 / 6,
+    1.0 / 120,
+    -1.0 / 5040,
+    1.0 / 362880,
+    -1.0 / 39916800,
+    1.0 / 6227020800.,
+    -1.0 / 1307674368000.,
+    1.0 / 355687428096000.,
+    -1.0 / 121645100408832000.,
+    1.0 / 51090942171709440000.,
+};
+constexpr int kSinDegree = sizeof(kSinCoeffs) / sizeof(kSinCoeffs[0]) - 1;
+
+// Приближение acos(x) = sqrt(1 - x) * P(x) на [0, 1] (Абрамовиц и Стиган, 4.4.46):
+// абсолютная погрешность не больше 2e-8 рад, то есть около 0.13 м на поверхности Земли
+constexpr double kAcosCoeffs[] = {
+    1.5707963050,
+    -0.2145988016,
+    0.0889789874,
+    -0.0501743046,
+    0.0308918810,
+    -0.0170881256,
+    0.0066700901,
+    -0.0012624911,
+};
+constexpr int kAcosDegree = sizeof(kAcosCoeffs) / sizeof(kAcosCoeffs[0]) - 1;
+
+// Синусы, косинусы широт и разность долгот одной пары точек
+struct PairTrig {
+    double sin_from;
+    double cos_from;
+    double sin_to;
+    double cos_to;
+    double delta_lng;
+    bool same;
+};
+
+double FastCos(double x) {
+    x = std::abs(x);
+    x -= std::nearbyint(x * kInvTwoPi) * kTwoPi;
+    const double z = x * x;
+    double result = kCosCoeffs[kCosDegree];
+    for (int i = kCosDegree - 1; i >= 0; --i) {
+        result = result * z + kCosCoeffs[i];
+    }
+    return result;
+}
+
+// Только для |x| <= pi/2
+double FastSin(double x) {
+    const double z = x * x;
+    double result = kSinCoeffs[kSinDegree];
+    for (int i = kSinDegree - 1; i >= 0; --i) {
+        result = result * z + kSinCoeffs[i];
+    }
+    return result * x;
+}
+
+double FastAcos(double x) {
+    x = std::clamp(x, -1.0, 1.0);
+    const double abs_x = std::abs(x);
+    double poly = kAcosCoeffs[kAcosDegree];
+    for (int i = kAcosDegree - 1; i >= 0; --i) {
+        poly = poly * abs_x + kAcosCoeffs[i];
+    }
+    const double result = std::sqrt(1.0 - abs_x) * poly;
+    return x < 0 ? M_PI - result : result;
+}
+
+double FastDistance(const PairTrig& pair) {
+    if (pair.same) {
+        return 0;
+    }
+    return FastAcos(pair.sin_from * pair.sin_to
+        + pair.cos_from * pair.cos_to * FastCos(pair.delta_lng * kDegToRad))
+        * kEarthRadius;
+}
+
+#if defined(__SSE2__)
+
+// Векторные версии FastCos, FastSin и FastAcos выполняют те же операции в том же порядке,
+// поэтому дают те же результаты, что и скалярные
+__m128d FastCos(__m128d x) {
+    x = _mm_andnot_pd(_mm_set1_pd(-0.0), x);
+    const __m128d turns = _mm_cvtepi32_pd(_mm_cvtpd_epi32(_mm_mul_pd(x, _mm_set1_pd(kInvTwoPi))));
+    x = _mm_sub_pd(x, _mm_mul_pd(turns, _mm_set1_pd(kTwoPi)));
+    const __m128d z = _mm_mul_pd(x, x);
+    __m128d result = _mm_set1_pd(kCosCoeffs[kCosDegree]);
+    for (int i = kCosDegree - 1; i >= 0; --i) {
+        result = _mm_add_pd(_mm_mul_pd(result, z), _mm_set1_pd(kCosCoeffs[i]));
+    }
+    return result;
+}
+
+__m128d FastSin(__m128d x) {
+    const __m128d z = _mm_mul_pd(x, x);
+    __m128d result = _mm_set1_pd(kSinCoeffs[kSinDegree]);
+    for (int i = kSinDegree - 1; i >= 0; --i) {
+        result = _mm_add_pd(_mm_mul_pd(result, z), _mm_set1_pd(kSinCoeffs[i]));
+    }
+    return _mm_mul_pd(result, x);
+}
+
+__m128d FastAcos(__m128d x) {
+    x = _mm_min_pd(_mm_max_pd(x, _mm_set1_pd(-1.0)), _mm_set1_pd(1.0));
+    const __m128d sign_mask = _mm_set1_pd(-0.0);
+    const __m128d abs_x = _mm_andnot_pd(sign_mask, x);
+    __m128d poly = _mm_set1_pd(kAcosCoeffs[kAcosDegree]);
+    for (int i = kAcosDegree - 1; i >= 0; --i) {
+        poly = _mm_add_pd(_mm_mul_pd(poly, abs_x), _mm_set1_pd(kAcosCoeffs[i]));
+    }
+    const __m128d result = _mm_mul_pd(_mm_sqrt_pd(_mm_sub_pd(_mm_set1_pd(1.0), abs_x)), poly);
+    const __m128d negative = _mm_cmplt_pd(x, _mm_setzero_pd());
+    const __m128d reflected = _mm_sub_pd(_mm_set1_pd(M_PI), result);
+    return _mm_or_pd(_mm_and_pd(negative, reflected), _mm_andnot_pd(negative, result));
+}
+
+#endif
+
+// Вычисляет sin и cos для массива широт в градусах
+void FastSinCos(const double* lat, size_t count, double* sin_out, double* cos_out) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128d dr = _mm_set1_pd(kDegToRad);
+    for (; i + 2 <= count; i += 2) {
+        const __m128d x = _mm_mul_pd(_mm_loadu_pd(lat + i), dr);
+        _mm_storeu_pd(cos_out + i, FastCos(x));
+        _mm_storeu_pd(sin_out + i, FastSin(x));
+    }
+#endif
+    for (; i < count; ++i) {
+        const double x = lat[i] * kDegToRad;
+        cos_out[i] = FastCos(x);
+        sin_out[i] = FastSin(x);
+    }
+}
+
+// Считает расстояния по парам, которые возвращает load(i)
+template <typename PairLoader>
+void FastDistances(size_t count, double* result, PairLoader load) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 2 <= count; i += 2) {
+        const PairTrig lo = load(i);
+        const PairTrig hi = load(i + 1);
+        const __m128d sin_from = _mm_set_pd(hi.sin_from, lo.sin_from);
+        const __m128d cos_from = _mm_set_pd(hi.cos_from, lo.cos_from);
+        const __m128d sin_to = _mm_set_pd(hi.sin_to, lo.sin_to);
+        const __m128d cos_to = _mm_set_pd(hi.cos_to, lo.cos_to);
+        const __m128d delta_lng = _mm_mul_pd(_mm_set_pd(hi.delta_lng, lo.delta_lng), _mm_set1_pd(kDegToRad));
+        const __m128d x = _mm_add_pd(_mm_mul_pd(sin_from, sin_to),
+            _mm_mul_pd(_mm_mul_pd(cos_from, cos_to), FastCos(delta_lng)));
+        _mm_storeu_pd(result + i, _mm_mul_pd(FastAcos(x), _mm_set1_pd(kEarthRadius)));
+        if (lo.same) {
+            result[i] = 0;
+        }
+        if (hi.same) {
+            result[i + 1] = 0;
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        result[i] = FastDistance(load(i));
+    }
+}
+
+}  // namespace
+
 double ComputeDistance(Coordinates from, Coordinates to) {
     using namespace std;
     if (from == to) {
@@ -18,4 +222,91 @@ double ComputeDistance(Coordinates from, Coordinates to) {
         * earth_rd;
 }
 
-}
\ No newline at end of file
+LatitudeTrigCache::LatitudeTrigCache(const double* lat, size_t count) {
+    Reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        Add(lat[i]);
+    }
+}
+
+void LatitudeTrigCache::Add(double lat) {
+    sin_lat_.push_back(std::sin(lat * kDegToRad));
+    cos_lat_.push_back(std::cos(lat * kDegToRad));
+}
+
+void LatitudeTrigCache::Set(size_t index, double lat) {
+    sin_lat_[index] = std::sin(lat * kDegToRad);
+    cos_lat_[index] = std::cos(lat * kDegToRad);
+}
+
+void LatitudeTrigCache::Reserve(size_t count) {
+    sin_lat_.reserve(count);
+    cos_lat_.reserve(count);
+}
+
+size_t LatitudeTrigCache::Size() const {
+    return sin_lat_.size();
+}
+
+const double* LatitudeTrigCache::SinData() const {
+    return sin_lat_.data();
+}
+
+const double* LatitudeTrigCache::CosData() const {
+    return cos_lat_.data();
+}
+
+void ComputeDistances(const double* from_lat, const double* from_lng,
+    const double* to_lat, const double* to_lng,
+    size_t count, double* result, DistancePrecision precision) {
+    if (precision == DistancePrecision::EXACT) {
+        for (size_t i = 0; i < count; ++i) {
+            result[i] = ComputeDistance({ from_lat[i], from_lng[i] }, { to_lat[i], to_lng[i] });
+        }
+        return;
+    }
+
+    // Синусы и косинусы широт считаются блоками, чтобы буферы оставались в кэше процессора
+    double sin_from[kBlockSize], cos_from[kBlockSize], sin_to[kBlockSize], cos_to[kBlockSize];
+    for (size_t begin = 0; begin < count; begin += kBlockSize) {
+        const size_t size = std::min(kBlockSize, count - begin);
+        FastSinCos(from_lat + begin, size, sin_from, cos_from);
+        FastSinCos(to_lat + begin, size, sin_to, cos_to);
+        FastDistances(size, result + begin, [&](size_t i) {
+            const size_t j = begin + i;
+            return PairTrig{ sin_from[i], cos_from[i], sin_to[i], cos_to[i],
+                from_lng[j] - to_lng[j],
+                from_lat[j] == to_lat[j] && from_lng[j] == to_lng[j] };
+        });
+    }
+}
+
+void ComputeDistances(const LatitudeTrigCache& cache, const double* lat, const double* lng,
+    const size_t* from, const size_t* to,
+    size_t count, double* result, DistancePrecision precision) {
+    const double* sin_lat = cache.SinData();
+    const double* cos_lat = cache.CosData();
+    auto load = [&](size_t i) {
+        const size_t f = from[i];
+        const size_t t = to[i];
+        return PairTrig{ sin_lat[f], cos_lat[f], sin_lat[t], cos_lat[t],
+            lng[f] - lng[t], lat[f] == lat[t] && lng[f] == lng[t] };
+    };
+
+    if (precision == DistancePrecision::FAST) {
+        FastDistances(count, result, load);
+        return;
+    }
+
+    // Тот же порядок операций, что и в ComputeDistance, поэтому результаты совпадают побитово
+    for (size_t i = 0; i < count; ++i) {
+        const PairTrig pair = load(i);
+        result[i] = pair.same
+            ? 0
+            : std::acos(pair.sin_from * pair.sin_to
+                + pair.cos_from * pair.cos_to * std::cos(std::abs(pair.delta_lng) * kDegToRad))
+                * kEarthRadius;
+    }
+}
+
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cmath>
+#include <cstddef>
+#include <vector>
 
 namespace geo {
 
@@ -15,6 +17,60 @@ struct Coordinates {
     }
 };
 
+// Прямоугольник координат: min — юго-западный угол, max — северо-восточный
+struct BoundingBox {
+    Coordinates min;
+    Coordinates max;
+
+    bool Contains(Coordinates point) const {
+        return min.lat <= point.lat && point.lat <= max.lat && min.lng <= point.lng && point.lng <= max.lng;
+    }
+    bool Intersects(const BoundingBox& other) const {
+        return min.lat <= other.max.lat && other.min.lat <= max.lat && min.lng <= other.max.lng && other.min.lng <= max.lng;
+    }
+};
+
 double ComputeDistance(Coordinates from, Coordinates to);
 
+// Точность пакетного расчёта расстояний:
+// EXACT — побитово совпадает с ComputeDistance (функции из <cmath>),
+// FAST — полиномиальные приближения sin/cos/acos, обрабатываемые SIMD-векторами;
+// абсолютная погрешность не превышает 0.2 м
+enum class DistancePrecision {
+    EXACT,
+    FAST,
+};
+
+// Синусы и косинусы широт набора точек, вычисленные один раз.
+// Точка добавляется в кэш под тем же индексом, что и в SoA-массивах координат
+class LatitudeTrigCache {
+public:
+    LatitudeTrigCache() = default;
+    LatitudeTrigCache(const double* lat, size_t count);
+
+    void Add(double lat);
+    void Set(size_t index, double lat);
+    void Reserve(size_t count);
+    size_t Size() const;
+
+    const double* SinData() const;
+    const double* CosData() const;
+
+private:
+    std::vector<double> sin_lat_;
+    std::vector<double> cos_lat_;
+};
+
+// Вычисляет расстояния между парами точек from[i] и to[i], заданных SoA-массивами
+// широт и долгот в градусах, и записывает их в result[0..count)
+void ComputeDistances(const double* from_lat, const double* from_lng,
+    const double* to_lat, const double* to_lng,
+    size_t count, double* result, DistancePrecision precision = DistancePrecision::EXACT);
+
+// То же для пар индексов точек from[i] и to[i] в массивах lat/lng.
+// Синусы и косинусы широт берутся из cache, построенного по тем же массивам
+void ComputeDistances(const LatitudeTrigCache& cache, const double* lat, const double* lng,
+    const size_t* from, const size_t* to,
+    size_t count, double* result, DistancePrecision precision = DistancePrecision::EXACT);
+
 }
\ No newline at end of file
@@ -0,0 +1,183 @@
+#include "gzip_stream.h"
+
+#include <stdexcept>
+
+namespace gzip {
+
+using namespace std::literals;
+
+namespace {
+
+// Размер блока, который передаётся потоку сжатия, и предел очереди таких блоков
+constexpr size_t BLOCK_SIZE = 64 * 1024;
+constexpr size_t MAX_QUEUED_BLOCKS = 4;
+// windowBits больше 15 на 16 — заголовок и контрольная сумма gzip вместо zlib
+constexpr int GZIP_WINDOW_BITS = 15 + 16;
+
+void InitDeflate(z_stream& stream) {
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, GZIP_WINDOW_BITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw std::runtime_error("Cannot initialize gzip compression"s);
+    }
+}
+
+}  // namespace
+
+std::string Compress(std::string_view data) {
+    z_stream stream{};
+    InitDeflate(stream);
+    std::string result(deflateBound(&stream, static_cast<uLong>(data.size())), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(result.data());
+    stream.avail_out = static_cast<uInt>(result.size());
+    const int status = deflate(&stream, Z_FINISH);
+    result.resize(stream.total_out);
+    deflateEnd(&stream);
+    if (status != Z_STREAM_END) {
+        throw std::runtime_error("gzip compression failed"s);
+    }
+    return result;
+}
+
+OStream::OStream(std::ostream& output)
+    : std::ostream(nullptr)
+    , buffer_(output) {
+    rdbuf(&buffer_);
+}
+
+void OStream::Finish() {
+    buffer_.Finish();
+}
+
+OStream::Buffer::Buffer(std::ostream& output)
+    : output_(output)
+    , block_(BLOCK_SIZE, '\0')
+    , compressed_(BLOCK_SIZE) {
+    InitDeflate(stream_);
+    setp(block_.data(), block_.data() + block_.size());
+    worker_ = std::thread([this] {
+        CompressLoop();
+    });
+}
+
+OStream::Buffer::~Buffer() {
+    try {
+        Finish();
+    }
+    catch (...) {
+    }
+}
+
+OStream::Buffer::int_type OStream::Buffer::overflow(int_type ch) {
+    if (!PushBlock(false)) {
+        return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+    return traits_type::not_eof(ch);
+}
+
+int OStream::Buffer::sync() {
+    return PushBlock(true) ? 0 : -1;
+}
+
+void OStream::Buffer::Finish() {
+    if (is_finished_) {
+        return;
+    }
+    is_finished_ = true;
+    PushBlock(false);
+    {
+        std::lock_guard lock(mutex_);
+        is_finishing_ = true;
+    }
+    block_ready_.notify_one();
+    worker_.join();
+    deflateEnd(&stream_);
+    setp(nullptr, nullptr);
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+}
+
+bool OStream::Buffer::PushBlock(bool flush) {
+    if (pptr() == pbase() && !flush) {
+        return true;
+    }
+    block_.resize(static_cast<size_t>(pptr() - pbase()));
+    {
+        std::unique_lock lock(mutex_);
+        queue_free_.wait(lock, [this] {
+            return blocks_.size() < MAX_QUEUED_BLOCKS || error_;
+        });
+        if (error_) {
+            return false;
+        }
+        blocks_.push_back({ std::move(block_), flush });
+    }
+    block_ready_.notify_one();
+    block_.assign(BLOCK_SIZE, '\0');
+    setp(block_.data(), block_.data() + block_.size());
+    return true;
+}
+
+void OStream::Buffer::CompressLoop() {
+    for (;;) {
+        Block block;
+        {
+            std::unique_lock lock(mutex_);
+            block_ready_.wait(lock, [this] {
+                return !blocks_.empty() || is_finishing_;
+            });
+            if (blocks_.empty()) {
+                break;
+            }
+            block = std::move(blocks_.front());
+            blocks_.pop_front();
+        }
+        queue_free_.notify_one();
+        try {
+            Deflate(block.data, block.flush ? Z_SYNC_FLUSH : Z_NO_FLUSH);
+            if (block.flush) {
+                output_.flush();
+            }
+        }
+        catch (...) {
+            std::lock_guard lock(mutex_);
+            error_ = std::current_exception();
+            // Очередь больше не нужна, а запись, ждущая места в ней, должна проснуться
+            blocks_.clear();
+            queue_free_.notify_all();
+            return;
+        }
+    }
+    try {
+        Deflate({}, Z_FINISH);
+        output_.flush();
+    }
+    catch (...) {
+        std::lock_guard lock(mutex_);
+        error_ = std::current_exception();
+    }
+}
+
+void OStream::Buffer::Deflate(std::string_view data, int flush) {
+    stream_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream_.avail_in = static_cast<uInt>(data.size());
+    // Выход забирается, пока deflate заполняет буфер целиком: значит, у него есть ещё данные
+    do {
+        stream_.next_out = reinterpret_cast<Bytef*>(compressed_.data());
+        stream_.avail_out = static_cast<uInt>(compressed_.size());
+        if (deflate(&stream_, flush) == Z_STREAM_ERROR) {
+            throw std::runtime_error("gzip compression failed"s);
+        }
+        output_.write(compressed_.data(), static_cast<std::streamsize>(compressed_.size() - stream_.avail_out));
+        if (!output_) {
+            throw std::runtime_error("Error writing compressed output"s);
+        }
+    } while (stream_.avail_out == 0);
+}
+
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <zlib.h>
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace gzip {
+
+// Сжимает данные целиком в формат gzip
+std::string Compress(std::string_view data);
+
+/*
+    * Поток вывода, который сжимает всё записанное в формат gzip и дописывает результат в output.
+    * Текст копится блоками; заполненный блок уходит отдельному потоку сжатия, а запись
+    * тем временем продолжается в следующий блок, поэтому подготовка ответов и сжатие идут
+    * одновременно. Очередь блоков ограничена: если сжатие не успевает, запись ждёт.
+    * flush сжимает накопленное с Z_SYNC_FLUSH, чтобы получатель мог распаковать всё выведенное.
+    * Finish дописывает конец gzip-потока и пробрасывает ошибки сжатия и вывода;
+    * деструктор вызывает его сам, если это не сделано, но ошибки при этом теряются
+    */
+class OStream : public std::ostream {
+public:
+    explicit OStream(std::ostream& output);
+    OStream(const OStream&) = delete;
+    OStream& operator=(const OStream&) = delete;
+
+    void Finish();
+
+private:
+    class Buffer : public std::streambuf {
+    public:
+        explicit Buffer(std::ostream& output);
+        ~Buffer() override;
+
+        void Finish();
+
+    protected:
+        int_type overflow(int_type ch) override;
+        int sync() override;
+
+    private:
+        struct Block {
+            std::string data;
+            bool flush = false;
+        };
+
+        std::ostream& output_;
+        z_stream stream_{};
+        std::string block_;
+        std::vector<char> compressed_;
+        std::thread worker_;
+
+        std::mutex mutex_;
+        std::condition_variable block_ready_;
+        std::condition_variable queue_free_;
+        std::deque<Block> blocks_;
+        bool is_finishing_ = false;
+        bool is_finished_ = false;
+        std::exception_ptr error_;
+
+        bool PushBlock(bool flush);
+        void CompressLoop();
+        void Deflate(std::string_view data, int flush);
+    };
+
+    Buffer buffer_;
+};
+
+}
@@ -1,7 +1,22 @@
 #include "json.h"
+#include "format.h"
 
+#include <cctype>
+#include <charconv>
+#include <fstream>
 #include <iterator>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace json {
 
 namespace {
@@ -234,14 +249,22 @@ Node LoadNode(std::istream& input) {
     }
 }
 
+bool IsSpace(char c) {
+    return std::isspace(static_cast<unsigned char>(c)) != 0;
+}
+
+bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
 struct PrintContext {
-    std::ostream& out;
+    format::Buffer& out;
     int indent_step = 4;
     int indent = 0;
 
     void PrintIndent() const {
         for (int i = 0; i < indent; ++i) {
-            out.put(' ');
+            out << ' ';
         }
     }
 
@@ -257,8 +280,8 @@ void PrintValue(const Value& value, const PrintContext& ctx) {
     ctx.out << value;
 }
 
-void PrintString(const std::string& value, std::ostream& out) {
-    out.put('"');
+void PrintString(const std::string& value, format::Buffer& out) {
+    out << '"';
     for (const char c : value) {
         switch (c) {
         case '\r':
@@ -271,14 +294,14 @@ void PrintString(const std::string& value, std::ostream& out) {
             // Ñèìâîëû " è \ âûâîäÿòñÿ êàê \" èëè \\, ñîîòâåòñòâåííî
             [[fallthrough]];
         case '\\':
-            out.put('\\');
+            out << '\\';
             [[fallthrough]];
         default:
-            out.put(c);
+            out << c;
             break;
         }
     }
-    out.put('"');
+    out << '"';
 }
 
 template <>
@@ -302,7 +325,7 @@ void PrintValue<bool>(const bool& value, const PrintContext& ctx) {
 
 template <>
 void PrintValue<Array>(const Array& nodes, const PrintContext& ctx) {
-    std::ostream& out = ctx.out;
+    format::Buffer& out = ctx.out;
     out << "[\n"sv;
     bool first = true;
     auto inner_ctx = ctx.Indented();
@@ -316,14 +339,14 @@ void PrintValue<Array>(const Array& nodes, const PrintContext& ctx) {
         inner_ctx.PrintIndent();
         PrintNode(node, inner_ctx);
     }
-    out.put('\n');
+    out << '\n';
     ctx.PrintIndent();
-    out.put(']');
+    out << ']';
 }
 
 template <>
 void PrintValue<Dict>(const Dict& nodes, const PrintContext& ctx) {
-    std::ostream& out = ctx.out;
+    format::Buffer& out = ctx.out;
     out << "{\n"sv;
     bool first = true;
     auto inner_ctx = ctx.Indented();
@@ -339,9 +362,9 @@ void PrintValue<Dict>(const Dict& nodes, const PrintContext& ctx) {
         out << ": "sv;
         PrintNode(node, inner_ctx);
     }
-    out.put('\n');
+    out << '\n';
     ctx.PrintIndent();
-    out.put('}');
+    out << '}';
 }
 
 void PrintNode(const Node& node, const PrintContext& ctx) {
@@ -358,8 +381,582 @@ Document Load(std::istream& input) {
     return Document{ LoadNode(input) };
 }
 
+Document Load(std::string_view input) {
+    return Document{ Reader(input).ReadNode() };
+}
+
+Document LoadFile(const std::string& path) {
+#if defined(__unix__) || defined(__APPLE__)
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw ParsingError("Failed to open "s + path);
+    }
+    struct stat file_stat {};
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        throw ParsingError("Failed to read "s + path);
+    }
+    const size_t size = static_cast<size_t>(file_stat.st_size);
+    if (size == 0) {
+        close(fd);
+        return Load(std::string_view{});
+    }
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        throw ParsingError("Failed to map "s + path);
+    }
+    madvise(data, size, MADV_SEQUENTIAL);
+    // Отображение снимается и при успешном разборе, и при исключении
+    struct Unmap {
+        void* data;
+        size_t size;
+        ~Unmap() {
+            munmap(data, size);
+        }
+    } unmap{ data, size };
+    return Load(std::string_view(static_cast<const char*>(data), size));
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw ParsingError("Failed to open "s + path);
+    }
+    return Load(ReadAll(file));
+#endif
+}
+
+std::string ReadAll(std::istream& input) {
+    std::string result;
+    char buffer[1 << 16];
+    while (input.read(buffer, sizeof(buffer)) || input.gcount() > 0) {
+        result.append(buffer, static_cast<size_t>(input.gcount()));
+    }
+    return result;
+}
+
+// Reader повторяет грамматику потокового разбора выше, но работает с указателями,
+// а длинные участки строк и пробелов просматривает SSE2-векторами
+Reader::Reader(std::string_view input)
+    : pos_(input.data())
+    , end_(input.data() + input.size()) {
+}
+
+Node Reader::ReadNode() {
+    SkipSpaces();
+    if (pos_ == end_) {
+        throw ParsingError("Unexpected EOF"s);
+    }
+    switch (*pos_) {
+    case '[':
+        ++pos_;
+        return LoadArray();
+    case '{':
+        ++pos_;
+        return LoadDict();
+    case '"':
+        ++pos_;
+        return Node(LoadString());
+    case 't':
+        [[fallthrough]];
+    case 'f':
+        return LoadBool();
+    case 'n':
+        return LoadNull();
+    default:
+        return LoadNumber();
+    }
+}
+
+void Reader::SkipSpaces() {
+#ifdef __SSE2__
+    // Отступы в документах обычно длинные, поэтому сначала пропускаем их по 16 байт
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i line_feed = _mm_set1_epi8('\n');
+    const __m128i carriage_return = _mm_set1_epi8('\r');
+    const __m128i tab = _mm_set1_epi8('\t');
+    while (end_ - pos_ >= 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos_));
+        const __m128i is_space = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, line_feed)),
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, carriage_return), _mm_cmpeq_epi8(chunk, tab)));
+        const unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(is_space)) & 0xFFFFu;
+        if (mask != 0) {
+            pos_ += __builtin_ctz(mask);
+            break;
+        }
+        pos_ += 16;
+    }
+#endif
+    while (pos_ != end_ && IsSpace(*pos_)) {
+        ++pos_;
+    }
+}
+
+// Возвращает следующий непробельный символ или '\0', если буфер закончился
+char Reader::NextChar() {
+    SkipSpaces();
+    return pos_ != end_ ? *pos_++ : '\0';
+}
+
+// Находит первый символ, который нельзя скопировать в строку как есть: " \ \n \r
+const char* Reader::FindStringSpecial(const char* begin) const {
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i line_feed = _mm_set1_epi8('\n');
+    const __m128i carriage_return = _mm_set1_epi8('\r');
+    while (end_ - begin >= 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        const __m128i is_special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, line_feed), _mm_cmpeq_epi8(chunk, carriage_return)));
+        const int mask = _mm_movemask_epi8(is_special);
+        if (mask != 0) {
+            return begin + __builtin_ctz(static_cast<unsigned>(mask));
+        }
+        begin += 16;
+    }
+#endif
+    while (begin != end_ && *begin != '"' && *begin != '\\' && *begin != '\n' && *begin != '\r') {
+        ++begin;
+    }
+    return begin;
+}
+
+Node Reader::LoadArray() {
+    std::vector<Node> result;
+    while (NextItem()) {
+        result.push_back(ReadNode());
+    }
+    return Node(std::move(result));
+}
+
+Node Reader::LoadDict() {
+    Dict dict;
+    for (std::string key; NextKey(key);) {
+        if (dict.find(key) != dict.end()) {
+            throw ParsingError("Duplicate key '"s + key + "' have been found");
+        }
+        Node value = ReadNode();
+        dict.emplace(std::move(key), std::move(value));
+    }
+    return Node(std::move(dict));
+}
+
+std::string Reader::LoadString() {
+    std::string s;
+    while (true) {
+        const char* special = FindStringSpecial(pos_);
+        s.append(pos_, special);
+        pos_ = special;
+        if (pos_ == end_) {
+            throw ParsingError("String parsing error");
+        }
+        const char ch = *pos_++;
+        if (ch == '"') {
+            break;
+        }
+        if (ch == '\n' || ch == '\r') {
+            throw ParsingError("Unexpected end of line"s);
+        }
+        if (pos_ == end_) {
+            throw ParsingError("String parsing error");
+        }
+        const char escaped_char = *pos_++;
+        switch (escaped_char) {
+        case 'n':
+            s.push_back('\n');
+            break;
+        case 't':
+            s.push_back('\t');
+            break;
+        case 'r':
+            s.push_back('\r');
+            break;
+        case '"':
+            s.push_back('"');
+            break;
+        case '\\':
+            s.push_back('\\');
+            break;
+        default:
+            throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
+        }
+    }
+    return s;
+}
+
+std::string_view Reader::LoadLiteral() {
+    const char* begin = pos_;
+    while (pos_ != end_ && std::isalpha(static_cast<unsigned char>(*pos_))) {
+        ++pos_;
+    }
+    return { begin, static_cast<size_t>(pos_ - begin) };
+}
+
+Node Reader::LoadBool() {
+    const auto s = LoadLiteral();
+    if (s == "true"sv) {
+        return Node{ true };
+    }
+    else if (s == "false"sv) {
+        return Node{ false };
+    }
+    else {
+        throw ParsingError("Failed to parse '"s + std::string(s) + "' as bool"s);
+    }
+}
+
+Node Reader::LoadNull() {
+    if (auto literal = LoadLiteral(); literal == "null"sv) {
+        return Node{ nullptr };
+    }
+    else {
+        throw ParsingError("Failed to parse '"s + std::string(literal) + "' as null"s);
+    }
+}
+
+Node Reader::LoadNumber() {
+    const char* begin = pos_;
+
+    auto read_digits = [this] {
+        if (pos_ == end_ || !IsDigit(*pos_)) {
+            throw ParsingError("A digit is expected"s);
+        }
+        while (pos_ != end_ && IsDigit(*pos_)) {
+            ++pos_;
+        }
+    };
+
+    if (pos_ != end_ && *pos_ == '-') {
+        ++pos_;
+    }
+    // После 0 в JSON не могут идти другие цифры
+    if (pos_ != end_ && *pos_ == '0') {
+        ++pos_;
+    }
+    else {
+        read_digits();
+    }
+
+    bool is_int = true;
+    if (pos_ != end_ && *pos_ == '.') {
+        ++pos_;
+        read_digits();
+        is_int = false;
+    }
+
+    if (pos_ != end_ && (*pos_ == 'e' || *pos_ == 'E')) {
+        ++pos_;
+        if (pos_ != end_ && (*pos_ == '+' || *pos_ == '-')) {
+            ++pos_;
+        }
+        read_digits();
+        is_int = false;
+    }
+
+    if (is_int) {
+        // При переполнении int число читается как double
+        int int_value = 0;
+        if (const auto [ptr, ec] = std::from_chars(begin, pos_, int_value); ec == std::errc{} && ptr == pos_) {
+            return int_value;
+        }
+    }
+    double double_value = 0.0;
+    if (const auto [ptr, ec] = std::from_chars(begin, pos_, double_value); ec != std::errc{} || ptr != pos_) {
+        throw ParsingError("Failed to convert "s + std::string(begin, pos_) + " to number"s);
+    }
+    return double_value;
+}
+
+void Reader::SkipNode() {
+    SkipSpaces();
+    if (pos_ == end_) {
+        throw ParsingError("Unexpected EOF"s);
+    }
+    switch (*pos_) {
+    case '[':
+        ++pos_;
+        while (NextItem()) {
+            SkipNode();
+        }
+        break;
+    case '{':
+        ++pos_;
+        for (std::string key; NextKey(key);) {
+            SkipNode();
+        }
+        break;
+    case '"':
+        ++pos_;
+        SkipString();
+        break;
+    case 't':
+        [[fallthrough]];
+    case 'f':
+        LoadBool();
+        break;
+    case 'n':
+        LoadNull();
+        break;
+    default:
+        LoadNumber();
+        break;
+    }
+}
+
+void Reader::SkipString() {
+    while (true) {
+        pos_ = FindStringSpecial(pos_);
+        if (pos_ == end_) {
+            throw ParsingError("String parsing error");
+        }
+        const char ch = *pos_++;
+        if (ch == '"') {
+            return;
+        }
+        if (ch == '\n' || ch == '\r') {
+            throw ParsingError("Unexpected end of line"s);
+        }
+        if (pos_ == end_) {
+            throw ParsingError("String parsing error");
+        }
+        ++pos_;
+    }
+}
+
+std::string_view Reader::Rest() const {
+    return { pos_, static_cast<size_t>(end_ - pos_) };
+}
+
+void Reader::BeginDict() {
+    if (NextChar() != '{') {
+        throw ParsingError("Dictionary is expected"s);
+    }
+}
+
+bool Reader::NextKey(std::string& key) {
+    if (!NextKeyStart()) {
+        return false;
+    }
+    key = LoadString();
+    ExpectColon();
+    return true;
+}
+
+// Пропускает разделители до открывающей кавычки ключа. Возвращает false, когда словарь закончился
+bool Reader::NextKeyStart() {
+    while (true) {
+        const char c = NextChar();
+        if (c == '\0' && pos_ == end_) {
+            throw ParsingError("Dictionary parsing error"s);
+        }
+        if (c == '}') {
+            return false;
+        }
+        if (c == '"') {
+            return true;
+        }
+        if (c != ',') {
+            throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+        }
+    }
+}
+
+void Reader::ExpectColon() {
+    if (const char c = NextChar(); c != ':') {
+        throw ParsingError(": is expected but '"s + c + "' has been found"s);
+    }
+}
+
+void Reader::BeginArray() {
+    if (NextChar() != '[') {
+        throw ParsingError("Array is expected"s);
+    }
+}
+
+bool Reader::NextItem() {
+    const char c = NextChar();
+    if (c == '\0' && pos_ == end_) {
+        throw ParsingError("Array parsing error"s);
+    }
+    if (c == ']') {
+        return false;
+    }
+    if (c != ',') {
+        --pos_;
+    }
+    return true;
+}
+
+StreamReader::StreamReader(std::istream& input)
+    : input_(&input) {
+}
+
+StreamReader::StreamReader(std::string text)
+    : buffer_(std::move(text)) {
+}
+
+bool StreamReader::Fill() {
+    if (!input_) {
+        return false;
+    }
+    buffer_.erase(0, pos_);
+    pos_ = 0;
+    const size_t size = buffer_.size();
+    buffer_.resize(size + CHUNK_SIZE);
+    input_->read(buffer_.data() + size, CHUNK_SIZE);
+    const auto count = static_cast<size_t>(input_->gcount());
+    buffer_.resize(size + count);
+    return count > 0;
+}
+
+char StreamReader::NextChar() {
+    while (true) {
+        while (pos_ != buffer_.size() && IsSpace(buffer_[pos_])) {
+            ++pos_;
+        }
+        if (pos_ != buffer_.size()) {
+            return buffer_[pos_++];
+        }
+        if (!Fill()) {
+            return '\0';
+        }
+    }
+}
+
+size_t StreamReader::FindValueEnd() {
+    if (NextChar() == '\0') {
+        throw ParsingError("Unexpected EOF"s);
+    }
+    --pos_;
+    // Дочитывает буфер, пока в нём нет символа со смещением offset от pos_. Fill сдвигает
+    // буфер вместе с pos_, поэтому смещения от pos_ при этом не меняются
+    const auto has_char = [this](size_t offset) {
+        while (pos_ + offset >= buffer_.size()) {
+            if (!Fill()) {
+                return false;
+            }
+        }
+        return true;
+    };
+    const char first = buffer_[pos_];
+    if (first != '{' && first != '[' && first != '"') {
+        // Число или литерал заканчиваются разделителем или концом входа
+        size_t offset = 0;
+        while (has_char(offset)) {
+            const char c = buffer_[pos_ + offset];
+            if (c == ',' || c == ']' || c == '}' || IsSpace(c)) {
+                break;
+            }
+            ++offset;
+        }
+        return offset;
+    }
+    // Скобки внутри строк не считаются
+    size_t depth = 0;
+    bool in_string = false;
+    bool escaped = false;
+    for (size_t offset = 0;; ++offset) {
+        if (!has_char(offset)) {
+            throw ParsingError("Unexpected EOF"s);
+        }
+        const char c = buffer_[pos_ + offset];
+        if (in_string) {
+            if (escaped) {
+                escaped = false;
+            }
+            else if (c == '\\') {
+                escaped = true;
+            }
+            else if (c == '"') {
+                in_string = false;
+                if (depth == 0) {
+                    return offset + 1;
+                }
+            }
+        }
+        else if (c == '"') {
+            in_string = true;
+        }
+        else if (c == '{' || c == '[') {
+            ++depth;
+        }
+        else if ((c == '}' || c == ']') && --depth == 0) {
+            return offset + 1;
+        }
+    }
+}
+
+void StreamReader::SkipNode() {
+    const size_t size = FindValueEnd();
+    Reader(std::string_view(buffer_).substr(pos_, size)).SkipNode();
+    pos_ += size;
+}
+
+std::string StreamReader::ReadText() {
+    const size_t size = FindValueEnd();
+    std::string result = buffer_.substr(pos_, size);
+    pos_ += size;
+    return result;
+}
+
+void StreamReader::BeginDict() {
+    if (NextChar() != '{') {
+        throw ParsingError("Dictionary is expected"s);
+    }
+}
+
+bool StreamReader::NextKey(std::string& key) {
+    while (true) {
+        const char c = NextChar();
+        if (c == '\0') {
+            throw ParsingError("Dictionary parsing error"s);
+        }
+        if (c == '}') {
+            return false;
+        }
+        if (c == '"') {
+            break;
+        }
+        if (c != ',') {
+            throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+        }
+    }
+    --pos_;
+    const size_t size = FindValueEnd();
+    key = Reader(std::string_view(buffer_).substr(pos_, size)).ReadNode().AsString();
+    pos_ += size;
+    if (const char c = NextChar(); c != ':') {
+        throw ParsingError(": is expected but '"s + c + "' has been found"s);
+    }
+    return true;
+}
+
+void StreamReader::BeginArray() {
+    if (NextChar() != '[') {
+        throw ParsingError("Array is expected"s);
+    }
+}
+
+bool StreamReader::NextItem() {
+    const char c = NextChar();
+    if (c == '\0') {
+        throw ParsingError("Array parsing error"s);
+    }
+    if (c == ']') {
+        return false;
+    }
+    if (c != ',') {
+        --pos_;
+    }
+    return true;
+}
+
 void Print(const Document& doc, std::ostream& output) {
-    PrintNode(doc.GetRoot(), PrintContext{ output });
+    format::Buffer buffer;
+    PrintNode(doc.GetRoot(), PrintContext{ buffer });
+    output << buffer.View();
 }
 
 }
\ No newline at end of file
@@ -3,12 +3,15 @@
 #include <iostream>
 #include <map>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
 namespace json {
 
 class Node;
+class FlatNode;
+class FlatDocument;
 using Dict = std::map<std::string, Node>;
 using Array = std::vector<Node>;
 
@@ -141,6 +144,107 @@ inline bool operator!=(const Document& lhs, const Document& rhs) {
 
 Document Load(std::istream& input);
 
+// Разбирает документ из непрерывного буфера. Строит то же дерево, что и Load(std::istream&),
+// но не читает поток посимвольно и преобразует числа через std::from_chars
+Document Load(std::string_view input);
+
+// Разбирает файл целиком; в POSIX-системах файл отображается в память через mmap
+Document LoadFile(const std::string& path);
+
+// Читает поток до конца одним буфером
+std::string ReadAll(std::istream& input);
+
+// Последовательное чтение документа из буфера. Позволяет обходить словари и массивы
+// поэлементно и разбирать в Node только текущий элемент, не строя дерево всего документа.
+// Буфер должен жить, пока с ним работает Reader
+class Reader {
+public:
+    explicit Reader(std::string_view input);
+
+    // Разбирает очередное значение целиком
+    Node ReadNode();
+    // Разбирает очередное значение в компактное представление из json_flat.h
+    FlatNode ReadFlatNode(FlatDocument& document);
+    // Пропускает очередное значение, не строя для него Node
+    void SkipNode();
+    // Ещё не прочитанная часть буфера
+    std::string_view Rest() const;
+
+    // Ожидает начало словаря
+    void BeginDict();
+    // Читает ключ очередного элемента словаря и разделитель ':'.
+    // Возвращает false, когда словарь закончился
+    bool NextKey(std::string& key);
+
+    // Ожидает начало массива
+    void BeginArray();
+    // Переходит к очередному элементу массива. Возвращает false, когда массив закончился
+    bool NextItem();
+
+private:
+    friend class StreamReader;
+
+    const char* pos_;
+    const char* end_;
+    // Копировать в арену документа и строки без escape-последовательностей, чтобы узлы не ссылались на буфер
+    bool store_strings_ = false;
+
+    void SkipSpaces();
+    char NextChar();
+    const char* FindStringSpecial(const char* begin) const;
+
+    bool NextKeyStart();
+    void ExpectColon();
+    void SkipString();
+    std::string_view LoadFlatString(FlatDocument& document);
+    Node LoadArray();
+    Node LoadDict();
+    std::string LoadString();
+    std::string_view LoadLiteral();
+    Node LoadBool();
+    Node LoadNull();
+    Node LoadNumber();
+};
+
+// Последовательное чтение документа из потока с тем же обходом, что и у Reader. В памяти держится
+// только ещё не разобранная часть входа: буфер дочитывается из потока кусками, когда очередное
+// значение в нём не поместилось, а разобранное при этом отбрасывается. Само значение разбирается Reader,
+// как только его текст целиком оказался в буфере, поэтому память ограничена размером самого большого значения
+class StreamReader {
+public:
+    explicit StreamReader(std::istream& input);
+    // Чтение уже прочитанного текста, без потока
+    explicit StreamReader(std::string text);
+
+    // Разбирает очередное значение в компактное представление. Все строки копируются в арену document,
+    // поэтому узлы остаются действительными и после того, как буфер дочитан
+    FlatNode ReadFlatNode(FlatDocument& document);
+    // Пропускает очередное значение
+    void SkipNode();
+    // Возвращает текст очередного значения как он есть во входе
+    std::string ReadText();
+
+    void BeginDict();
+    bool NextKey(std::string& key);
+    void BeginArray();
+    bool NextItem();
+
+private:
+    static constexpr size_t CHUNK_SIZE = 1 << 16;
+
+    std::istream* input_ = nullptr;
+    std::string buffer_;
+    // Начало непрочитанной части буфера
+    size_t pos_ = 0;
+
+    // Отбрасывает прочитанное и дочитывает очередной кусок. Возвращает false, если поток закончился
+    bool Fill();
+    // Следующий непробельный символ или '\0', если вход закончился
+    char NextChar();
+    // Длина текста очередного значения от pos_; дочитывает буфер, пока значение не закончится
+    size_t FindValueEnd();
+};
+
 void Print(const Document& doc, std::ostream& output);
 
 }
\ No newline at end of file
@@ -0,0 +1,315 @@
+#include "json_flat.h"
+#include "json.h"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+namespace json {
+
+using namespace std::literals;
+
+// ---------- FlatArray ---------------
+
+FlatArray::FlatArray(const FlatNode* items, size_t size)
+    : items_(items)
+    , size_(size) {
+}
+
+const FlatNode* FlatArray::begin() const {
+    return items_;
+}
+
+const FlatNode* FlatArray::end() const {
+    return items_ + size_;
+}
+
+size_t FlatArray::size() const {
+    return size_;
+}
+
+bool FlatArray::empty() const {
+    return size_ == 0;
+}
+
+const FlatNode& FlatArray::operator[](size_t index) const {
+    return items_[index];
+}
+
+// ---------- FlatDict ----------------
+
+FlatDict::FlatDict(const FlatMember* members, size_t size)
+    : members_(members)
+    , size_(size) {
+}
+
+FlatDict::const_iterator FlatDict::begin() const {
+    return members_;
+}
+
+FlatDict::const_iterator FlatDict::end() const {
+    return members_ + size_;
+}
+
+size_t FlatDict::size() const {
+    return size_;
+}
+
+bool FlatDict::empty() const {
+    return size_ == 0;
+}
+
+FlatDict::const_iterator FlatDict::find(std::string_view key) const {
+    const auto it = std::lower_bound(begin(), end(), key,
+        [](const FlatMember& member, std::string_view key) {
+            return member.first < key;
+        });
+    return it != end() && it->first == key ? it : end();
+}
+
+size_t FlatDict::count(std::string_view key) const {
+    return find(key) != end() ? 1 : 0;
+}
+
+const FlatNode& FlatDict::at(std::string_view key) const {
+    const auto it = find(key);
+    if (it == end()) {
+        throw std::out_of_range("No key "s + std::string(key));
+    }
+    return it->second;
+}
+
+// ---------- FlatNode ----------------
+
+FlatNode::FlatNode(bool value)
+    : type_(Type::BOOL) {
+    bool_ = value;
+}
+
+FlatNode::FlatNode(int value)
+    : type_(Type::INT) {
+    int_ = value;
+}
+
+FlatNode::FlatNode(double value)
+    : type_(Type::DOUBLE) {
+    double_ = value;
+}
+
+FlatNode::FlatNode(std::string_view value)
+    : type_(Type::STRING)
+    , size_(value.size()) {
+    chars_ = value.data();
+}
+
+FlatNode::FlatNode(FlatArray value)
+    : type_(Type::ARRAY)
+    , size_(value.size()) {
+    items_ = value.begin();
+}
+
+FlatNode::FlatNode(FlatDict value)
+    : type_(Type::DICT)
+    , size_(value.size()) {
+    members_ = value.begin();
+}
+
+bool FlatNode::IsNull() const {
+    return type_ == Type::NULL_VALUE;
+}
+
+bool FlatNode::IsBool() const {
+    return type_ == Type::BOOL;
+}
+
+bool FlatNode::IsInt() const {
+    return type_ == Type::INT;
+}
+
+bool FlatNode::IsPureDouble() const {
+    return type_ == Type::DOUBLE;
+}
+
+bool FlatNode::IsDouble() const {
+    return IsInt() || IsPureDouble();
+}
+
+bool FlatNode::IsString() const {
+    return type_ == Type::STRING;
+}
+
+bool FlatNode::IsArray() const {
+    return type_ == Type::ARRAY;
+}
+
+bool FlatNode::IsDict() const {
+    return type_ == Type::DICT;
+}
+
+bool FlatNode::AsBool() const {
+    if (!IsBool()) {
+        throw std::logic_error("Not a bool"s);
+    }
+    return bool_;
+}
+
+int FlatNode::AsInt() const {
+    if (!IsInt()) {
+        throw std::logic_error("Not an int"s);
+    }
+    return int_;
+}
+
+double FlatNode::AsDouble() const {
+    if (!IsDouble()) {
+        throw std::logic_error("Not a double"s);
+    }
+    return IsPureDouble() ? double_ : int_;
+}
+
+std::string_view FlatNode::AsString() const {
+    if (!IsString()) {
+        throw std::logic_error("Not a string"s);
+    }
+    return { chars_, size_ };
+}
+
+FlatArray FlatNode::AsArray() const {
+    if (!IsArray()) {
+        throw std::logic_error("Not an array"s);
+    }
+    return { items_, size_ };
+}
+
+FlatDict FlatNode::AsDict() const {
+    if (!IsDict()) {
+        throw std::logic_error("Not a dict"s);
+    }
+    return { members_, size_ };
+}
+
+// ---------- FlatDocument ------------
+
+FlatDocument::FlatDocument()
+    : arena_(initial_block_.data(), initial_block_.size()) {
+}
+
+FlatNode FlatDocument::Parse(Reader& reader) {
+    return reader.ReadFlatNode(*this);
+}
+
+std::string_view FlatDocument::StoreString(std::string_view value) {
+    if (value.empty()) {
+        return {};
+    }
+    auto* chars = static_cast<char*>(arena_.allocate(value.size(), alignof(char)));
+    std::copy(value.begin(), value.end(), chars);
+    return { chars, value.size() };
+}
+
+FlatNode FlatDocument::MakeArray(const FlatNode* first, const FlatNode* last) {
+    const size_t size = static_cast<size_t>(last - first);
+    if (size == 0) {
+        return FlatNode(FlatArray{});
+    }
+    auto* items = static_cast<FlatNode*>(arena_.allocate(size * sizeof(FlatNode), alignof(FlatNode)));
+    std::uninitialized_copy(first, last, items);
+    return FlatNode(FlatArray(items, size));
+}
+
+FlatNode FlatDocument::MakeDict(FlatMember* first, FlatMember* last) {
+    const size_t size = static_cast<size_t>(last - first);
+    if (size == 0) {
+        return FlatNode(FlatDict{});
+    }
+    std::sort(first, last, [](const FlatMember& lhs, const FlatMember& rhs) {
+        return lhs.first < rhs.first;
+    });
+    const auto duplicate = std::adjacent_find(first, last, [](const FlatMember& lhs, const FlatMember& rhs) {
+        return lhs.first == rhs.first;
+    });
+    if (duplicate != last) {
+        throw ParsingError("Duplicate key '"s + std::string(duplicate->first) + "' have been found");
+    }
+    auto* members = static_cast<FlatMember*>(arena_.allocate(size * sizeof(FlatMember), alignof(FlatMember)));
+    std::uninitialized_copy(first, last, members);
+    return FlatNode(FlatDict(members, size));
+}
+
+void FlatDocument::Clear() {
+    arena_.release();
+}
+
+// ---------- Reader ------------------
+
+FlatNode Reader::ReadFlatNode(FlatDocument& document) {
+    SkipSpaces();
+    if (pos_ == end_) {
+        throw ParsingError("Unexpected EOF"s);
+    }
+    switch (*pos_) {
+    case '[': {
+        ++pos_;
+        auto& items = document.items_stack_;
+        const size_t first = items.size();
+        while (NextItem()) {
+            const FlatNode item = ReadFlatNode(document);
+            items.push_back(item);
+        }
+        const FlatNode result = document.MakeArray(items.data() + first, items.data() + items.size());
+        items.resize(first);
+        return result;
+    }
+    case '{': {
+        ++pos_;
+        auto& members = document.members_stack_;
+        const size_t first = members.size();
+        while (NextKeyStart()) {
+            const std::string_view key = LoadFlatString(document);
+            ExpectColon();
+            const FlatNode value = ReadFlatNode(document);
+            members.push_back({ key, value });
+        }
+        const FlatNode result = document.MakeDict(members.data() + first, members.data() + members.size());
+        members.resize(first);
+        return result;
+    }
+    case '"':
+        ++pos_;
+        return FlatNode(LoadFlatString(document));
+    case 't':
+        [[fallthrough]];
+    case 'f':
+        return FlatNode(LoadBool().AsBool());
+    case 'n':
+        LoadNull();
+        return FlatNode();
+    default: {
+        const Node number = LoadNumber();
+        return number.IsInt() ? FlatNode(number.AsInt()) : FlatNode(number.AsDouble());
+    }
+    }
+}
+
+std::string_view Reader::LoadFlatString(FlatDocument& document) {
+    // Строка без escape-последовательностей берётся прямо из входного буфера
+    const char* begin = pos_;
+    const char* special = FindStringSpecial(begin);
+    if (special != end_ && *special == '"') {
+        pos_ = special + 1;
+        const std::string_view value(begin, static_cast<size_t>(special - begin));
+        return store_strings_ ? document.StoreString(value) : value;
+    }
+    return document.StoreString(LoadString());
+}
+
+FlatNode StreamReader::ReadFlatNode(FlatDocument& document) {
+    const size_t size = FindValueEnd();
+    Reader reader(std::string_view(buffer_).substr(pos_, size));
+    reader.store_strings_ = true;
+    const FlatNode result = reader.ReadFlatNode(document);
+    pos_ += size;
+    return result;
+}
+
+}
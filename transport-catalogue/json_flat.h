@@ -0,0 +1,147 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace json {
+
+class Reader;
+class FlatNode;
+struct FlatMember;
+
+// Непрерывный участок элементов массива в арене документа
+class FlatArray {
+public:
+    FlatArray() = default;
+    FlatArray(const FlatNode* items, size_t size);
+
+    const FlatNode* begin() const;
+    const FlatNode* end() const;
+    size_t size() const;
+    bool empty() const;
+    const FlatNode& operator[](size_t index) const;
+
+private:
+    const FlatNode* items_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Словарь в виде отсортированного по ключу массива пар; поиск — двоичный.
+// Интерфейс повторяет используемую часть std::map
+class FlatDict {
+public:
+    using const_iterator = const FlatMember*;
+
+    FlatDict() = default;
+    FlatDict(const FlatMember* members, size_t size);
+
+    const_iterator begin() const;
+    const_iterator end() const;
+    size_t size() const;
+    bool empty() const;
+
+    const_iterator find(std::string_view key) const;
+    size_t count(std::string_view key) const;
+    // Как и std::map::at, бросает std::out_of_range, если ключа нет
+    const FlatNode& at(std::string_view key) const;
+
+private:
+    const FlatMember* members_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Узел компактного представления JSON. Сам узел не владеет данными: строки указывают
+// во входной буфер или в арену FlatDocument, массивы и словари — в арену
+class FlatNode {
+public:
+    FlatNode() = default;
+    explicit FlatNode(bool value);
+    explicit FlatNode(int value);
+    explicit FlatNode(double value);
+    explicit FlatNode(std::string_view value);
+    explicit FlatNode(FlatArray value);
+    explicit FlatNode(FlatDict value);
+
+    bool IsNull() const;
+    bool IsBool() const;
+    bool IsInt() const;
+    bool IsPureDouble() const;
+    bool IsDouble() const;
+    bool IsString() const;
+    bool IsArray() const;
+    bool IsDict() const;
+
+    bool AsBool() const;
+    int AsInt() const;
+    double AsDouble() const;
+    std::string_view AsString() const;
+    FlatArray AsArray() const;
+    FlatDict AsDict() const;
+
+private:
+    enum class Type : uint8_t {
+        NULL_VALUE,
+        BOOL,
+        INT,
+        DOUBLE,
+        STRING,
+        ARRAY,
+        DICT,
+    };
+
+    Type type_ = Type::NULL_VALUE;
+    size_t size_ = 0;
+    union {
+        bool bool_;
+        int int_;
+        double double_;
+        const char* chars_;
+        const FlatNode* items_;
+        const FlatMember* members_ = nullptr;
+    };
+};
+
+// Поля названы как у std::map::value_type, чтобы код, написанный для Dict, работал без изменений
+struct FlatMember {
+    std::string_view first;
+    FlatNode second;
+};
+
+// Владелец узлов компактного представления. Узлы размещаются в монотонной арене,
+// поэтому разбор не выделяет память на каждый узел, а освобождается всё разом в Clear.
+// Ключи и строки без escape-последовательностей ссылаются на входной буфер,
+// поэтому он должен жить не меньше документа
+class FlatDocument {
+public:
+    FlatDocument();
+    FlatDocument(const FlatDocument&) = delete;
+    FlatDocument& operator=(const FlatDocument&) = delete;
+
+    // Разбирает очередное значение из reader
+    FlatNode Parse(Reader& reader);
+
+    // Копирует строку в арену
+    std::string_view StoreString(std::string_view value);
+    FlatNode MakeArray(const FlatNode* first, const FlatNode* last);
+    // Сортирует элементы по ключу и копирует их в арену. Бросает ParsingError при повторе ключа
+    FlatNode MakeDict(FlatMember* first, FlatMember* last);
+
+    // Освобождает все узлы документа. Начальный блок арены используется повторно
+    void Clear();
+
+private:
+    friend class Reader;
+
+    std::array<std::byte, 4096> initial_block_;
+    std::pmr::monotonic_buffer_resource arena_;
+    // Стеки ещё не законченных массивов и словарей во время разбора
+    std::vector<FlatNode> items_stack_;
+    std::vector<FlatMember> members_stack_;
+};
+
+}
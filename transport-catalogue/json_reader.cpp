@@ -1,146 +1,415 @@
 #include "json_reader.h" 
-#include "json_builder.h" 
+#include "json_writer.h" 
+#include "gzip_stream.h" 
+#include "thread_pool.h" 
+ 
+#include <algorithm> 
+ 
 using namespace std::literals; 
  
-const json::Node& JsonReader::GetBaseRequests() const { 
-    const auto& root = input_.GetRoot().AsDict(); 
-    if (root.count("base_requests"s) == 0) { 
+namespace { 
+ 
+std::string EncodeBase64(std::string_view data) { 
+    static constexpr std::string_view alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"sv; 
+    std::string result; 
+    result.reserve((data.size() + 2) / 3 * 4); 
+    for (size_t i = 0; i < data.size(); i += 3) { 
+        const size_t count = std::min<size_t>(3, data.size() - i); 
+        uint32_t group = 0; 
+        for (size_t j = 0; j < 3; ++j) { 
+            group = (group << 8) | (j < count ? static_cast<unsigned char>(data[i + j]) : 0u); 
+        } 
+        for (size_t j = 0; j < 4; ++j) { 
+            result += j <= count ? alphabet[(group >> (18 - 6 * j)) & 0x3F] : '='; 
+        } 
+    } 
+    return result; 
+} 
+ 
+}  // namespace 
+ 
+const json::FlatNode& JsonReader::GetBaseRequests() const { 
+    const auto root = root_.AsDict(); 
+    if (root.count("base_requests"sv) == 0) { 
         return dummy_; 
     } 
-    return root.at("base_requests"s); 
+    return root.at("base_requests"sv); 
 } 
  
-const json::Node& JsonReader::GetStatRequests() const { 
-    const auto& root = input_.GetRoot().AsDict(); 
-    if (root.count("stat_requests"s) == 0) { 
+const json::FlatNode& JsonReader::GetStatRequests() const { 
+    const auto root = root_.AsDict(); 
+    if (root.count("stat_requests"sv) == 0) { 
         return dummy_; 
     } 
-    return root.at("stat_requests"s); 
+    return root.at("stat_requests"sv); 
 } 
  
-const json::Node& JsonReader::GetRenderSettings() const { 
-    const auto& root = input_.GetRoot().AsDict(); 
-    if (root.count("render_settings"s) == 0) { 
+const json::FlatNode& JsonReader::GetRenderSettings() const { 
+    const auto root = root_.AsDict(); 
+    if (root.count("render_settings"sv) == 0) { 
         return dummy_; 
     } 
-    return root.at("render_settings"s); 
+    return root.at("render_settings"sv); 
 } 
  
-const json::Node& JsonReader::GetRoutingSettings() const { 
-    const auto& root = input_.GetRoot().AsDict(); 
-    if (root.count("routing_settings"s) == 0) { 
+const json::FlatNode& JsonReader::GetRoutingSettings() const { 
+    const auto root = root_.AsDict(); 
+    if (root.count("routing_settings"sv) == 0) { 
         return dummy_; 
     } 
-    return root.at("routing_settings"s); 
+    return root.at("routing_settings"sv); 
+} 
+ 
+void JsonReader::SetNumberStyle(format::DoubleStyle style) { 
+    number_style_ = style; 
+} 
+ 
+const format::DoubleStyle& JsonReader::GetNumberStyle() const { 
+    return number_style_; 
 } 
  
-const json::Node& JsonReader::GetSerializationSettings() const { 
-    const auto& root = input_.GetRoot().AsDict(); 
-    if (root.count("serialization_settings"s) == 0) { 
+const json::FlatNode& JsonReader::GetSerializationSettings() const { 
+    const auto root = root_.AsDict(); 
+    if (root.count("serialization_settings"sv) == 0) { 
         return dummy_; 
     } 
-    return root.at("serialization_settings"s); 
+    return root.at("serialization_settings"sv); 
 } 
  
-void JsonReader::ProcessRequests(const json::Node& stat_requests, RequestHandler& rh) const { 
-    json::Array result; 
-    for (const auto& request : stat_requests.AsArray()) { 
-        const auto& request_map = request.AsDict(); 
-        const auto& type = request_map.at("type"s).AsString(); 
-        if (type == "Stop"s) { 
-            result.push_back(PrintStop(request_map, rh).AsDict()); 
+void JsonReader::ProcessStatRequests(const RequestHandler& rh, std::ostream& output, size_t threads_count) { 
+    json::Writer writer(number_style_); 
+    writer.BeginArray(); 
+    if (stat_requests_ && threads_count > 1) { 
+        ProcessStatRequestsParallel(rh, writer, output, threads_count); 
+    } 
+    else if (stat_requests_) { 
+        json::StreamReader& reader = *stat_requests_; 
+        json::FlatDocument document; 
+        reader.BeginArray(); 
+        while (reader.NextItem()) { 
+            const json::FlatNode request = reader.ReadFlatNode(document); 
+            ProcessRequest(request.AsDict(), rh, writer); 
+            writer.Flush(output); 
+            document.Clear(); 
         } 
-        else if (type == "Bus"s) { 
-            result.push_back(PrintRoute(request_map, rh).AsDict()); 
+    } 
+    writer.EndArray(); 
+    writer.Flush(output); 
+    if (stat_requests_ && !is_root_read_) { 
+        // Разделы входа после stat_requests 
+        ReadRootMembers(*stat_requests_, {}); 
+    } 
+    stat_requests_.reset(); 
+} 
+ 
+void JsonReader::ProcessStatRequestsParallel(const RequestHandler& rh, json::Writer& writer, std::ostream& output, size_t threads_count) { 
+    // Запросы читаются из потока пачками, чтобы память не росла с размером входа 
+    constexpr size_t batch_size = 4096; 
+    const size_t chunk_size = std::max<size_t>(1, batch_size / (threads_count * 8)); 
+ 
+    ThreadPool pool(threads_count); 
+    json::StreamReader& reader = *stat_requests_; 
+    json::FlatDocument document; 
+    std::vector<json::FlatNode> requests; 
+    requests.reserve(batch_size); 
+    reader.BeginArray(); 
+    for (bool has_more = true; has_more;) { 
+        document.Clear(); 
+        requests.clear(); 
+        while (requests.size() < batch_size && (has_more = reader.NextItem())) { 
+            requests.push_back(reader.ReadFlatNode(document)); 
         } 
-        else if (type == "Map"s) { 
-            result.push_back(PrintMap(request_map, rh).AsDict()); 
+ 
+        // Каждая задача пишет ответы на свой участок запросов в отдельный буфер 
+        const size_t chunks_count = (requests.size() + chunk_size - 1) / chunk_size; 
+        std::vector<json::Writer> chunk_writers(chunks_count, json::Writer(number_style_)); 
+        std::vector<std::function<void()>> tasks; 
+        tasks.reserve(chunks_count); 
+        for (size_t chunk = 0; chunk < chunks_count; ++chunk) { 
+            tasks.push_back([this, &rh, &requests, &chunk_writers, chunk, chunk_size] { 
+                json::Writer& chunk_writer = chunk_writers[chunk]; 
+                chunk_writer.BeginArray(); 
+                const size_t end = std::min(requests.size(), (chunk + 1) * chunk_size); 
+                for (size_t i = chunk * chunk_size; i < end; ++i) { 
+                    ProcessRequest(requests[i].AsDict(), rh, chunk_writer); 
+                } 
+            }); 
         } 
-        else if (type == "Route"s) { 
-            result.push_back(PrintRouting(request_map, rh).AsDict()); 
+        pool.Run(std::move(tasks)); 
+ 
+        for (const auto& chunk_writer : chunk_writers) { 
+            writer.ArrayItems(chunk_writer); 
         } 
+        writer.Flush(output); 
     } 
-    json::Print(json::Document{ result }, std::cout); 
 } 
  
-void JsonReader::FillCatalogue(transport::Catalogue& catalogue) { 
-    const auto& arr = GetBaseRequests().AsArray(); 
-    for (const auto& request_stops : arr) { 
-        const auto& request_stops_map = request_stops.AsDict(); 
-        const auto& type = request_stops_map.at("type"s).AsString(); 
-        if (type == "Stop"s) { 
-            auto [stop_name, coordinates, stop_distances] = FillStop(request_stops_map); 
+void JsonReader::ProcessRequest(const json::FlatDict& request_map, const RequestHandler& rh, json::Writer& writer) const { 
+    const auto& type = request_map.at("type"sv).AsString(); 
+    if (type == "Stop"sv) { 
+        PrintStop(request_map, rh, writer); 
+    } 
+    else if (type == "Bus"sv) { 
+        PrintRoute(request_map, rh, writer); 
+    } 
+    else if (type == "Map"sv) { 
+        PrintMap(request_map, rh, writer); 
+    } 
+    else if (type == "Route"sv) { 
+        PrintRouting(request_map, rh, writer); 
+    } 
+    else if (type == "RouteMap"sv) { 
+        PrintRouteMap(request_map, rh, writer); 
+    } 
+    else if (type == "Tile"sv) { 
+        PrintTile(request_map, rh, writer); 
+    } 
+} 
+ 
+JsonReader::JsonReader(std::istream& input) 
+    : buffer_(json::ReadAll(input)) 
+{ 
+    json::Reader reader(buffer_); 
+    root_ = reader.ReadFlatNode(document_); 
+} 
+ 
+JsonReader::JsonReader(std::istream& input, transport::Catalogue& catalogue) 
+{ 
+    // Вход читается из потока кусками: в памяти одновременно только текущий элемент base_requests 
+    json::StreamReader reader(input); 
+    reader.BeginDict(); 
+    if (ReadRootMembers(reader, "base_requests"sv)) { 
+        FillCatalogue(reader, catalogue); 
+        ReadRootMembers(reader, {}); 
+    } 
+} 
+ 
+JsonReader::JsonReader(std::istream& input, StatRequestsMode mode) 
+{ 
+    if (mode == StatRequestsMode::DOCUMENT) { 
+        buffer_ = json::ReadAll(input); 
+        json::Reader reader(buffer_); 
+        root_ = reader.ReadFlatNode(document_); 
+        return; 
+    } 
+    // Запросы разбираются позже, когда база уже загружена: поток остаётся на начале stat_requests 
+    stat_requests_ = std::make_unique<json::StreamReader>(input); 
+    stat_requests_->BeginDict(); 
+    if (!ReadRootMembers(*stat_requests_, "stat_requests"sv)) { 
+        stat_requests_.reset(); 
+        return; 
+    } 
+    if (root_.AsDict().count("serialization_settings"sv) == 0) { 
+        // Файл базы указан после запросов, поэтому их текст приходится сохранить, чтобы дочитать вход 
+        std::string text = stat_requests_->ReadText(); 
+        ReadRootMembers(*stat_requests_, {}); 
+        stat_requests_ = std::make_unique<json::StreamReader>(std::move(text)); 
+        is_root_read_ = true; 
+    } 
+} 
+ 
+bool JsonReader::ReadRootMembers(json::StreamReader& reader, std::string_view section) { 
+    bool has_section = false; 
+    for (std::string key; !has_section && reader.NextKey(key);) { 
+        if (!section.empty() && key == section) { 
+            has_section = true; 
+        } 
+        else { 
+            const json::FlatNode value = reader.ReadFlatNode(document_); 
+            root_members_.push_back({ document_.StoreString(key), value }); 
+        } 
+    } 
+    // MakeDict сортирует копию, поэтому root_members_ можно дополнять и дальше 
+    root_ = document_.MakeDict(root_members_.data(), root_members_.data() + root_members_.size()); 
+    return has_section; 
+} 
+ 
+void JsonReader::FillCatalogue(json::StreamReader& reader, transport::Catalogue& catalogue) const { 
+    // Ссылки на остановки, которые ещё не встречались во входе, откладываются до конца массива 
+    struct PendingDistance { 
+        std::string from; 
+        std::string to; 
+        int distance; 
+    }; 
+    struct PendingRoute { 
+        std::string number; 
+        std::vector<std::string> stops; 
+        bool is_circle; 
+    }; 
+    std::vector<PendingDistance> pending_distances; 
+    std::vector<PendingRoute> pending_routes; 
+ 
+    // Каждый элемент разбирается в одну и ту же арену, которая очищается перед следующим 
+    json::FlatDocument document; 
+    reader.BeginArray(); 
+    while (reader.NextItem()) { 
+        document.Clear(); 
+        const json::FlatNode request = reader.ReadFlatNode(document); 
+        const auto& request_map = request.AsDict(); 
+        const auto& type = request_map.at("type"sv).AsString(); 
+        if (type == "Stop"sv) { 
+            auto [stop_name, coordinates, stop_distances] = FillStop(request_map); 
             catalogue.AddStop(stop_name, coordinates); 
+            const auto* from = catalogue.FindStop(stop_name); 
+            for (const auto& [to_name, dist] : stop_distances) { 
+                if (const auto* to = catalogue.FindStop(to_name)) { 
+                    catalogue.SetDistance(from, to, dist); 
+                } 
+                else { 
+                    pending_distances.push_back({ std::string(stop_name), std::string(to_name), dist }); 
+                } 
+            } 
         } 
+        else if (type == "Bus"sv) { 
+            auto [bus_number, stops, circular_route] = FillRoute(request_map, catalogue); 
+            if (std::find(stops.begin(), stops.end(), nullptr) == stops.end()) { 
+                catalogue.AddRoute(bus_number, stops, circular_route); 
+                continue; 
+            } 
+            PendingRoute route{ std::string(bus_number), {}, circular_route }; 
+            for (const auto& stop : request_map.at("stops"sv).AsArray()) { 
+                route.stops.emplace_back(stop.AsString()); 
+            } 
+            pending_routes.push_back(std::move(route)); 
+        } 
+    } 
+ 
+    for (const auto& [from, to, distance] : pending_distances) { 
+        catalogue.SetDistance(catalogue.FindStop(from), catalogue.FindStop(to), distance); 
     } 
-    FillStopDistances(catalogue); 
-    for (const auto& request_bus : arr) { 
-        const auto& request_bus_map = request_bus.AsDict(); 
-        const auto& type = request_bus_map.at("type"s).AsString(); 
-        if (type == "Bus"s) { 
-            auto [bus_number, stops, circular_route] = FillRoute(request_bus_map, catalogue); 
-            catalogue.AddRoute(bus_number, stops, circular_route); 
+    for (const auto& route : pending_routes) { 
+        std::vector<const transport::Stop*> stops; 
+        stops.reserve(route.stops.size()); 
+        for (const auto& stop_name : route.stops) { 
+            stops.push_back(catalogue.FindStop(stop_name)); 
         } 
+        catalogue.AddRoute(route.number, stops, route.is_circle); 
     } 
 } 
  
-std::tuple<std::string_view, geo::Coordinates, std::map<std::string_view, int>> JsonReader::FillStop(const json::Dict& request_map) const { 
-    std::string_view stop_name = request_map.at("name"s).AsString(); 
-    geo::Coordinates coordinates = { request_map.at("latitude"s).AsDouble(), request_map.at("longitude"s).AsDouble() }; 
-    std::map<std::string_view, int> stop_distances; 
-    const auto& distances = request_map.at("road_distances"s).AsDict(); 
-    for (const auto& [stop_name, dist] : distances) { 
-        stop_distances.emplace(stop_name, dist.AsInt()); 
-    } 
-    return std::make_tuple(stop_name, coordinates, stop_distances); 
+std::set<std::string> JsonReader::UpdateCatalogue(transport::Catalogue& catalogue) const { 
+    return UpdateCatalogue(GetBaseRequests(), catalogue); 
 } 
  
-void JsonReader::FillStopDistances(transport::Catalogue& catalogue) const { 
-    const auto& arr = GetBaseRequests().AsArray(); 
-    for (const auto& request_stops : arr) { 
-        const auto& request_stops_map = request_stops.AsDict(); 
-        const auto& type = request_stops_map.at("type"s).AsString(); 
-        if (type == "Stop"s) { 
-            auto [stop_name, coordinates, stop_distances] = FillStop(request_stops_map); 
-            for (const auto& [to_name, dist] : stop_distances) { 
-                auto from = catalogue.FindStop(stop_name); 
-                auto to = catalogue.FindStop(to_name); 
-                catalogue.SetDistance(from, to, dist); 
+std::set<std::string> JsonReader::UpdateCatalogue(const json::FlatNode& base_requests, transport::Catalogue& catalogue) const { 
+    const auto& arr = base_requests.AsArray(); 
+    std::set<std::string> changed_buses; 
+    std::set<std::string> changed_distance_stops; 
+    auto is_removal = [](const json::FlatDict& request_map) { 
+        const auto it = request_map.find("remove"sv); 
+        return it != request_map.end() && it->second.AsBool(); 
+    }; 
+ 
+    // Новые остановки и новые координаты существующих 
+    for (const auto& request : arr) { 
+        const auto& request_map = request.AsDict(); 
+        if (request_map.at("type"sv).AsString() == "Stop"s && !is_removal(request_map) && request_map.count("latitude"sv)) { 
+            catalogue.AddStop(request_map.at("name"sv).AsString(), 
+                { request_map.at("latitude"sv).AsDouble(), request_map.at("longitude"sv).AsDouble() }); 
+        } 
+    } 
+    // Расстояния: число задаёт или меняет расстояние, null удаляет его 
+    for (const auto& request : arr) { 
+        const auto& request_map = request.AsDict(); 
+        if (request_map.at("type"sv).AsString() != "Stop"s || is_removal(request_map) || !request_map.count("road_distances"sv)) { 
+            continue; 
+        } 
+        const auto& stop_name = request_map.at("name"sv).AsString(); 
+        const auto* from = catalogue.FindStop(stop_name); 
+        if (!from) { 
+            throw std::logic_error("Unknown stop "s + std::string(stop_name)); 
+        } 
+        for (const auto& [to_name, dist] : request_map.at("road_distances"sv).AsDict()) { 
+            const auto* to = catalogue.FindStop(to_name); 
+            if (!to) { 
+                throw std::logic_error("Unknown stop "s + std::string(to_name)); 
+            } 
+            if (dist.IsNull()) { 
+                catalogue.RemoveDistance(from, to); 
+            } 
+            else { 
+                catalogue.SetDistance(from, to, dist.AsInt()); 
             } 
+            changed_distance_stops.emplace(stop_name); 
+            changed_distance_stops.emplace(to_name); 
+        } 
+    } 
+    // Маршруты добавляются, заменяются целиком или удаляются 
+    for (const auto& request : arr) { 
+        const auto& request_map = request.AsDict(); 
+        if (request_map.at("type"sv).AsString() != "Bus"sv) { 
+            continue; 
+        } 
+        const auto& bus_number = request_map.at("name"sv).AsString(); 
+        if (is_removal(request_map)) { 
+            catalogue.RemoveRoute(bus_number); 
+        } 
+        else { 
+            auto [number, stops, circular_route] = FillRoute(request_map, catalogue); 
+            if (const auto unknown = std::find(stops.begin(), stops.end(), nullptr); unknown != stops.end()) { 
+                const auto& stop_name = request_map.at("stops"sv).AsArray()[unknown - stops.begin()].AsString(); 
+                throw std::logic_error("Unknown stop "s + std::string(stop_name)); 
+            } 
+            catalogue.AddRoute(number, stops, circular_route); 
+        } 
+        changed_buses.emplace(bus_number); 
+    } 
+    // Остановки удаляются последними, когда маршруты через них уже изменены 
+    for (const auto& request : arr) { 
+        const auto& request_map = request.AsDict(); 
+        if (request_map.at("type"sv).AsString() == "Stop"s && is_removal(request_map)) { 
+            catalogue.RemoveStop(request_map.at("name"sv).AsString()); 
+        } 
+    } 
+    for (const auto& stop_name : changed_distance_stops) { 
+        if (const auto* stop = catalogue.FindStop(stop_name)) { 
+            changed_buses.insert(stop->buses_by_stop.begin(), stop->buses_by_stop.end()); 
         } 
     } 
+    return changed_buses; 
 } 
  
-std::tuple<std::string_view, std::vector<const transport::Stop*>, bool> JsonReader::FillRoute(const json::Dict& request_map, transport::Catalogue& catalogue) const { 
-    std::string_view bus_number = request_map.at("name"s).AsString(); 
+std::tuple<std::string_view, geo::Coordinates, std::map<std::string_view, int>> JsonReader::FillStop(const json::FlatDict& request_map) const { 
+    std::string_view stop_name = request_map.at("name"sv).AsString(); 
+    geo::Coordinates coordinates = { request_map.at("latitude"sv).AsDouble(), request_map.at("longitude"sv).AsDouble() }; 
+    std::map<std::string_view, int> stop_distances; 
+    const auto& distances = request_map.at("road_distances"sv).AsDict(); 
+    for (const auto& [stop_name, dist] : distances) { 
+        stop_distances.emplace(stop_name, dist.AsInt()); 
+    } 
+    return std::make_tuple(stop_name, coordinates, stop_distances); 
+} 
+ 
+std::tuple<std::string_view, std::vector<const transport::Stop*>, bool> JsonReader::FillRoute(const json::FlatDict& request_map, transport::Catalogue& catalogue) const { 
+    std::string_view bus_number = request_map.at("name"sv).AsString(); 
     std::vector<const transport::Stop*> stops; 
-    for (const auto& stop : request_map.at("stops"s).AsArray()) { 
+    for (const auto& stop : request_map.at("stops"sv).AsArray()) { 
         stops.push_back(catalogue.FindStop(stop.AsString())); 
     } 
-    bool circular_route = request_map.at("is_roundtrip"s).AsBool(); 
+    bool circular_route = request_map.at("is_roundtrip"sv).AsBool(); 
     return std::make_tuple(bus_number, stops, circular_route); 
 } 
  
-renderer::MapRenderer JsonReader::FillRenderSettings(const json::Node& settings) const { 
+renderer::MapRenderer JsonReader::FillRenderSettings(const json::FlatNode& settings) const { 
     const auto& request_map = settings.AsDict(); 
     renderer::RenderSettings render_settings; 
-    render_settings.width = request_map.at("width"s).AsDouble(); 
-    render_settings.height = request_map.at("height"s).AsDouble(); 
-    render_settings.padding = request_map.at("padding"s).AsDouble(); 
-    render_settings.stop_radius = request_map.at("stop_radius"s).AsDouble(); 
-    render_settings.line_width = request_map.at("line_width"s).AsDouble(); 
-    render_settings.bus_label_font_size = request_map.at("bus_label_font_size"s).AsInt(); 
-    const auto& bus_label_offset = request_map.at("bus_label_offset"s).AsArray(); 
+    render_settings.width = request_map.at("width"sv).AsDouble(); 
+    render_settings.height = request_map.at("height"sv).AsDouble(); 
+    render_settings.padding = request_map.at("padding"sv).AsDouble(); 
+    render_settings.stop_radius = request_map.at("stop_radius"sv).AsDouble(); 
+    render_settings.line_width = request_map.at("line_width"sv).AsDouble(); 
+    render_settings.bus_label_font_size = request_map.at("bus_label_font_size"sv).AsInt(); 
+    const auto& bus_label_offset = request_map.at("bus_label_offset"sv).AsArray(); 
     render_settings.bus_label_offset = { bus_label_offset[0].AsDouble(), bus_label_offset[1].AsDouble() }; 
-    render_settings.stop_label_font_size = request_map.at("stop_label_font_size"s).AsInt(); 
-    const auto& stop_label_offset = request_map.at("stop_label_offset"s).AsArray(); 
+    render_settings.stop_label_font_size = request_map.at("stop_label_font_size"sv).AsInt(); 
+    const auto& stop_label_offset = request_map.at("stop_label_offset"sv).AsArray(); 
     render_settings.stop_label_offset = { stop_label_offset[0].AsDouble(), stop_label_offset[1].AsDouble() }; 
      
-    if (request_map.at("underlayer_color"s).IsString()) { 
-        render_settings.underlayer_color = request_map.at("underlayer_color"s).AsString(); 
+    if (request_map.at("underlayer_color"sv).IsString()) { 
+        render_settings.underlayer_color = std::string(request_map.at("underlayer_color"sv).AsString()); 
     } 
-    else if (request_map.at("underlayer_color"s).IsArray()) { 
-        const auto& underlayer_color = request_map.at("underlayer_color"s).AsArray(); 
+    else if (request_map.at("underlayer_color"sv).IsArray()) { 
+        const auto& underlayer_color = request_map.at("underlayer_color"sv).AsArray(); 
         if (underlayer_color.size() == 3) { 
             render_settings.underlayer_color = svg::Rgb(underlayer_color[0].AsInt(), underlayer_color[1].AsInt(), underlayer_color[2].AsInt()); 
         } 
@@ -155,11 +424,11 @@ renderer::MapRenderer JsonReader::FillRenderSettings(const json::Node& settings)
         throw std::logic_error("wrong underlayer color"s); 
     } 
      
-    render_settings.underlayer_width = request_map.at("underlayer_width"s).AsDouble(); 
-    const auto& color_palette = request_map.at("color_palette"s).AsArray(); 
+    render_settings.underlayer_width = request_map.at("underlayer_width"sv).AsDouble(); 
+    const auto& color_palette = request_map.at("color_palette"sv).AsArray(); 
     for (const auto& color_element : color_palette) { 
         if (color_element.IsString()) { 
-            render_settings.color_palette.push_back(color_element.AsString()); 
+            render_settings.color_palette.push_back(std::string(color_element.AsString())); 
         } 
         else if (color_element.IsArray()) { 
             const auto& color_type = color_element.AsArray(); 
@@ -177,132 +446,194 @@ renderer::MapRenderer JsonReader::FillRenderSettings(const json::Node& settings)
             throw std::logic_error("wrong color_palette"s); 
         } 
     } 
+    if (const auto compact_svg = request_map.find("compact_svg"sv); compact_svg != request_map.end()) { 
+        render_settings.compact_svg = compact_svg->second.AsBool(); 
+    } 
+    if (const auto number_format = request_map.find("number_format"sv); number_format != request_map.end()) { 
+        const auto number_style = format::ParseDoubleStyle(number_format->second.AsString()); 
+        if (!number_style) { 
+            throw std::logic_error("wrong number_format"s); 
+        } 
+        render_settings.number_style = *number_style; 
+    } 
+    if (const auto simplify_tolerance = request_map.find("simplify_tolerance"sv); simplify_tolerance != request_map.end()) { 
+        render_settings.simplify_tolerance = simplify_tolerance->second.AsDouble(); 
+        if (render_settings.simplify_tolerance < 0.0) { 
+            throw std::logic_error("wrong simplify_tolerance"s); 
+        } 
+    } 
+    if (const auto tile_levels = request_map.find("tile_levels"sv); tile_levels != request_map.end()) { 
+        render_settings.tile_levels = tile_levels->second.AsInt(); 
+        if (render_settings.tile_levels < 0 || render_settings.tile_levels > renderer::MAX_TILE_LEVELS) { 
+            throw std::logic_error("wrong tile_levels"s); 
+        } 
+    } 
+    if (const auto tile_size = request_map.find("tile_size"sv); tile_size != request_map.end()) { 
+        render_settings.tile_size = tile_size->second.AsInt(); 
+        if (render_settings.tile_size <= 0) { 
+            throw std::logic_error("wrong tile_size"s); 
+        } 
+    } 
     return render_settings; 
 } 
  
-transport::Router JsonReader::FillRoutingSettings(const json::Node& settings) const { 
+transport::Router JsonReader::FillRoutingSettings(const json::FlatNode& settings) const { 
     const auto& routing_settings = settings.AsDict(); 
-    return transport::Router{ routing_settings.at("bus_wait_time"s).AsInt(), routing_settings.at("bus_velocity"s).AsDouble() }; 
+    return transport::Router{ routing_settings.at("bus_wait_time"sv).AsInt(), routing_settings.at("bus_velocity"sv).AsDouble() }; 
 } 
  
-const json::Node JsonReader::PrintRoute(const json::Dict& request_map, RequestHandler& rh) const { 
-    json::Node result; 
-    const std::string& route_number = request_map.at("name"s).AsString(); 
-    const int id = request_map.at("id"s).AsInt(); 
+void JsonReader::PrintRoute(const json::FlatDict& request_map, const RequestHandler& rh, json::Writer& writer) const { 
+    const std::string_view route_number = request_map.at("name"sv).AsString(); 
+    const int id = request_map.at("id"sv).AsInt(); 
     if (!rh.IsBusNumber(route_number)) { 
-        result = json::Builder{} 
-            .StartDict() 
-                .Key("request_id"s).Value(id) 
-                .Key("error_message"s).Value("not found"s) 
-            .EndDict() 
-        .Build(); 
+        PrintNotFound(id, writer); 
+        return; 
     } 
-    else { 
-        const auto& route_info = rh.GetBusStat(route_number); 
-        result = json::Builder{} 
-            .StartDict() 
-                .Key("request_id"s).Value(id) 
-                .Key("curvature"s).Value(route_info->curvature) 
-                .Key("route_length"s).Value(route_info->route_length) 
-                .Key("stop_count"s).Value(static_cast<int>(route_info->stops_count)) 
-                .Key("unique_stop_count"s).Value(static_cast<int>(route_info->unique_stops_count)) 
-            .EndDict() 
-        .Build(); 
-    } 
-    return result; 
+    const auto& route_info = rh.GetBusStat(route_number); 
+    writer.BeginObject() 
+        .Key("curvature"sv).Double(route_info->curvature) 
+        .Key("request_id"sv).Int(id) 
+        .Key("route_length"sv).Double(route_info->route_length) 
+        .Key("stop_count"sv).Int(static_cast<int>(route_info->stops_count)) 
+        .Key("unique_stop_count"sv).Int(static_cast<int>(route_info->unique_stops_count)) 
+    .EndObject(); 
 } 
  
-const json::Node JsonReader::PrintStop(const json::Dict& request_map, RequestHandler& rh) const { 
-    json::Node result; 
-    const std::string& stop_name = request_map.at("name"s).AsString(); 
-    const int id = request_map.at("id"s).AsInt(); 
+void JsonReader::PrintStop(const json::FlatDict& request_map, const RequestHandler& rh, json::Writer& writer) const { 
+    const std::string_view stop_name = request_map.at("name"sv).AsString(); 
+    const int id = request_map.at("id"sv).AsInt(); 
     if (!rh.IsStopName(stop_name)) { 
-        result = json::Builder{} 
-            .StartDict() 
-                .Key("request_id"s).Value(id) 
-                .Key("error_message"s).Value("not found"s) 
-            .EndDict() 
-        .Build(); 
+        PrintNotFound(id, writer); 
+        return; 
+    } 
+    writer.BeginObject().Key("buses"sv).BeginArray(); 
+    for (const auto& bus : rh.GetBusesByStop(stop_name)) { 
+        writer.String(bus); 
+    } 
+    writer.EndArray() 
+        .Key("request_id"sv).Int(id) 
+    .EndObject(); 
+} 
+ 
+void JsonReader::PrintMap(const json::FlatDict& request_map, const RequestHandler& rh, json::Writer& writer) const { 
+    const int id = request_map.at("id"sv).AsInt(); 
+    // Без bbox отдаётся заранее нарисованная карта всей сети 
+    const auto view = FillMapView(request_map); 
+    format::Buffer svg_text; 
+    if (view) { 
+        rh.RenderMap(*view).Render(svg_text); 
+        PrintMapText(request_map, id, svg_text.View(), writer); 
     } 
     else { 
-        json::Array buses; 
-        for (const auto& bus : rh.GetBusesByStop(stop_name)) { 
-            buses.push_back(bus); 
-        } 
-        result = json::Builder{} 
-            .StartDict() 
-                .Key("request_id"s).Value(id) 
-                .Key("buses"s).Value(buses) 
-            .EndDict() 
-        .Build(); 
+        PrintMapText(request_map, id, rh.GetMapSvg(), writer, rh.GetMapSvgGzip()); 
     } 
-    return result; 
 } 
  
-const json::Node JsonReader::PrintMap(const json::Dict& request_map, RequestHandler& rh) const { 
-    json::Node result; 
-    const int id = request_map.at("id"s).AsInt(); 
-    std::ostringstream strm; 
-    svg::Document map = rh.RenderMap(); 
-    map.Render(strm); 
-    result = json::Builder{} 
-        .StartDict() 
-            .Key("request_id"s).Value(id) 
-            .Key("map"s).Value(strm.str()) 
-        .EndDict() 
-    .Build(); 
-    return result; 
+void JsonReader::PrintRouteMap(const json::FlatDict& request_map, const RequestHandler& rh, json::Writer& writer) const { 
+    const int id = request_map.at("id"sv).AsInt(); 
+    const auto route_map = rh.RenderRouteMap(request_map.at("from"sv).AsString(), request_map.at("to"sv).AsString()); 
+    if (!route_map) { 
+        PrintNotFound(id, writer); 
+        return; 
+    } 
+    format::Buffer svg_text; 
+    route_map->Render(svg_text); 
+    PrintMapText(request_map, id, svg_text.View(), writer); 
+} 
+ 
+void JsonReader::PrintTile(const json::FlatDict& request_map, const RequestHandler& rh, json::Writer& writer) const { 
+    const int id = request_map.at("id"sv).AsInt(); 
+    const std::string* tile = rh.GetTile(request_map.at("zoom"sv).AsInt(), request_map.at("x"sv).AsInt(), request_map.at("y"sv).AsInt()); 
+    if (!tile) { 
+        PrintNotFound(id, writer); 
+        return; 
+    } 
+    PrintMapText(request_map, id, *tile, writer); 
+} 
+ 
+void JsonReader::PrintMapText(const json::FlatDict& request_map, int id, std::string_view svg_text, json::Writer& writer, 
+    std::string_view svg_gzip) const { 
+    const auto encoding = request_map.find("encoding"sv); 
+    if (encoding == request_map.end()) { 
+        writer.BeginObject() 
+            .Key("map"sv).String(svg_text) 
+            .Key("request_id"sv).Int(id) 
+        .EndObject(); 
+        return; 
+    } 
+    if (encoding->second.AsString() != "gzip"sv) { 
+        PrintError(id, "unknown map encoding"sv, writer); 
+        return; 
+    } 
+    // Сжатая карта в base64 не требует экранирования и в несколько раз короче строки с SVG 
+    writer.BeginObject() 
+        .Key("map_gzip"sv).String(svg_gzip.empty() ? EncodeBase64(gzip::Compress(svg_text)) : EncodeBase64(svg_gzip)) 
+        .Key("request_id"sv).Int(id) 
+    .EndObject(); 
 } 
  
-const json::Node JsonReader::PrintRouting(const json::Dict& request_map, RequestHandler& rh) const { 
-    json::Node result; 
-    const int id = request_map.at("id"s).AsInt(); 
-    const std::string_view stop_from = request_map.at("from"s).AsString(); 
-    const std::string_view stop_to = request_map.at("to"s).AsString(); 
+std::optional<renderer::MapView> JsonReader::FillMapView(const json::FlatDict& request_map) const { 
+    const auto bbox = request_map.find("bbox"sv); 
+    if (bbox == request_map.end()) { 
+        return std::nullopt; 
+    } 
+    const json::FlatDict box = bbox->second.AsDict(); 
+    renderer::MapView view; 
+    view.box.min = { box.at("min_lat"sv).AsDouble(), box.at("min_lng"sv).AsDouble() }; 
+    view.box.max = { box.at("max_lat"sv).AsDouble(), box.at("max_lng"sv).AsDouble() }; 
+    if (const auto width = request_map.find("width"sv); width != request_map.end()) { 
+        view.width = width->second.AsDouble(); 
+    } 
+    if (const auto height = request_map.find("height"sv); height != request_map.end()) { 
+        view.height = height->second.AsDouble(); 
+    } 
+    return view; 
+} 
+ 
+void JsonReader::PrintRouting(const json::FlatDict& request_map, const RequestHandler& rh, json::Writer& writer) const { 
+    const int id = request_map.at("id"sv).AsInt(); 
+    const std::string_view stop_from = request_map.at("from"sv).AsString(); 
+    const std::string_view stop_to = request_map.at("to"sv).AsString(); 
     const auto& routing = rh.GetOptimalRoute(stop_from, stop_to); 
     if (!routing) { 
-        result = json::Builder{} 
-            .StartDict() 
-                .Key("request_id"s).Value(id) 
-                .Key("error_message"s).Value("not found"s) 
-            .EndDict() 
-        .Build(); 
+        PrintNotFound(id, writer); 
+        return; 
     } 
-    else { 
-        json::Array items; 
-        double total_time = 0.0; 
-        items.reserve(routing.value().edges.size()); 
-        for (const auto& edge_id : routing.value().edges) { 
-            const auto& edge = rh.GetRouterGraph().GetEdge(edge_id); 
-            if (edge.quality == 0) { 
-                items.emplace_back(json::Node(json::Builder{} 
-                    .StartDict() 
-                        .Key("stop_name"s).Value(edge.name) 
-                        .Key("time"s).Value(edge.weight) 
-                        .Key("type"s).Value("Wait"s) 
-                    .EndDict() 
-                .Build())); 
-                total_time += edge.weight; 
-            } 
-            else { 
-                items.emplace_back(json::Node(json::Builder{} 
-                    .StartDict() 
-                        .Key("bus"s).Value(edge.name) 
-                        .Key("span_count"s).Value(static_cast<int>(edge.quality)) 
-                        .Key("time"s).Value(edge.weight) 
-                        .Key("type"s).Value("Bus"s) 
-                    .EndDict() 
-                .Build())); 
-                total_time += edge.weight; 
-            } 
+    // Ключи выводятся по алфавиту, поэтому items идут раньше total_time 
+    double total_time = 0.0; 
+    writer.BeginObject().Key("items"sv).BeginArray(); 
+    for (const auto& edge_id : routing.value().edges) { 
+        const auto& edge = rh.GetRouterGraph().GetEdge(edge_id); 
+        if (edge.quality == 0) { 
+            writer.BeginObject() 
+                .Key("stop_name"sv).String(edge.name) 
+                .Key("time"sv).Double(edge.weight) 
+                .Key("type"sv).String("Wait"sv) 
+            .EndObject(); 
+        } 
+        else { 
+            writer.BeginObject() 
+                .Key("bus"sv).String(edge.name) 
+                .Key("span_count"sv).Int(static_cast<int>(edge.quality)) 
+                .Key("time"sv).Double(edge.weight) 
+                .Key("type"sv).String("Bus"sv) 
+            .EndObject(); 
         } 
-        result = json::Builder{} 
-            .StartDict() 
-                .Key("request_id"s).Value(id) 
-                .Key("total_time"s).Value(total_time) 
-                .Key("items"s).Value(items) 
-            .EndDict() 
-        .Build(); 
+        total_time += edge.weight; 
     } 
-    return result; 
+    writer.EndArray() 
+        .Key("request_id"sv).Int(id) 
+        .Key("total_time"sv).Double(total_time) 
+    .EndObject(); 
+} 
+ 
+void JsonReader::PrintNotFound(int id, json::Writer& writer) const { 
+    PrintError(id, "not found"sv, writer); 
+} 
+ 
+void JsonReader::PrintError(int id, std::string_view message, json::Writer& writer) const { 
+    writer.BeginObject() 
+        .Key("error_message"sv).String(message) 
+        .Key("request_id"sv).Int(id) 
+    .EndObject(); 
 }
\ No newline at end of file
@@ -1,40 +1,95 @@
 #pragma once
 
 #include "json.h"
+#include "json_flat.h"
+#include "json_writer.h"
 #include "transport_catalogue.h"
 #include "map_renderer.h"
 #include "request_handler.h"
 
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+
+// Способ чтения stat_requests: DOCUMENT разбирает их вместе со всем входом,
+// STREAM откладывает до ProcessStatRequests и дочитывает из потока по одному запросу
+enum class StatRequestsMode {
+    DOCUMENT,
+    STREAM,
+};
 
 class JsonReader {
 public:
-    JsonReader(std::istream& input)
-        : input_(json::Load(input))
-    {}
+    JsonReader(std::istream& input);
+    // Потоковый режим: вход читается из потока кусками, base_requests не сохраняются в документе,
+    // а по одному элементу передаются в catalogue. Остальные разделы входа доступны через Get*-методы как обычно
+    JsonReader(std::istream& input, transport::Catalogue& catalogue);
+    JsonReader(std::istream& input, StatRequestsMode mode);
 
-    const json::Node& GetBaseRequests() const;
-    const json::Node& GetStatRequests() const;
-    const json::Node& GetRenderSettings() const;
-    const json::Node& GetRoutingSettings() const;
-    const json::Node& GetSerializationSettings() const;
+    const json::FlatNode& GetBaseRequests() const;
+    const json::FlatNode& GetStatRequests() const;
+    const json::FlatNode& GetRenderSettings() const;
+    const json::FlatNode& GetRoutingSettings() const;
+    const json::FlatNode& GetSerializationSettings() const;
+    // Стиль чисел с плавающей точкой в JSON-ответах; по умолчанию вывод совпадает с std::ostream
+    void SetNumberStyle(format::DoubleStyle style);
+    const format::DoubleStyle& GetNumberStyle() const;
 
-    void ProcessRequests(const json::Node& stat_requests, RequestHandler& rh) const;
+    // Отвечает на отложенные в режиме STREAM запросы и выводит каждый ответ сразу после вычисления.
+    // При threads_count > 1 запросы читаются пачками и выполняются параллельно,
+    // а ответы выводятся в исходном порядке
+    void ProcessStatRequests(const RequestHandler& rh, std::ostream& output, size_t threads_count = 1);
+    // Пишет ответ на один запрос; запросы неизвестного типа пропускаются
+    void ProcessRequest(const json::FlatDict& request_map, const RequestHandler& rh, json::Writer& writer) const;
 
-    void FillCatalogue(transport::Catalogue& catalogue);
-    renderer::MapRenderer FillRenderSettings(const json::Node& settings) const;
-    transport::Router FillRoutingSettings(const json::Node& settings) const;
+    // Применяет base_requests как приращение к уже заполненному справочнику.
+    // Возвращает номера маршрутов, рёбра графа которых нужно перестроить
+    std::set<std::string> UpdateCatalogue(transport::Catalogue& catalogue) const;
+    // То же для правок base_requests, пришедших не во входе, например в запросе Update режима serve
+    std::set<std::string> UpdateCatalogue(const json::FlatNode& base_requests, transport::Catalogue& catalogue) const;
+    renderer::MapRenderer FillRenderSettings(const json::FlatNode& settings) const;
+    transport::Router FillRoutingSettings(const json::FlatNode& settings) const;
 
-    const json::Node PrintRoute(const json::Dict& request_map, RequestHandler& rh) const;
-    const json::Node PrintStop(const json::Dict& request_map, RequestHandler& rh) const;
-    const json::Node PrintMap(const json::Dict& request_map, RequestHandler& rh) const;
-    const json::Node PrintRouting(const json::Dict& request_map, RequestHandler& rh) const;
+    void PrintRoute(const json::FlatDict& request_map, const RequestHandler& rh, json::Writer& writer) const;
+    void PrintStop(const json::FlatDict& request_map, const RequestHandler& rh, json::Writer& writer) const;
+    void PrintMap(const json::FlatDict& request_map, const RequestHandler& rh, json::Writer& writer) const;
+    void PrintRouteMap(const json::FlatDict& request_map, const RequestHandler& rh, json::Writer& writer) const;
+    void PrintTile(const json::FlatDict& request_map, const RequestHandler& rh, json::Writer& writer) const;
+    void PrintRouting(const json::FlatDict& request_map, const RequestHandler& rh, json::Writer& writer) const;
 
 private:
-    json::Document input_;
-    json::Node dummy_ = nullptr;
+    // Исходный текст входа: строки документа ссылаются на него. Разделы, прочитанные из потока
+    // через json::StreamReader, хранят свои строки в арене документа и буфера не требуют
+    std::string buffer_;
+    json::FlatDocument document_;
+    json::FlatNode root_;
+    json::FlatNode dummy_;
+    // Элементы корневого словаря, прочитанные из потока
+    std::vector<json::FlatMember> root_members_;
+    // Вход в режиме STREAM, остановленный на начале stat_requests. Если файл базы указан
+    // после запросов, здесь сохранённый текст запросов
+    std::unique_ptr<json::StreamReader> stat_requests_;
+    // Корневой словарь дочитан до конца, и stat_requests_ читает только сохранённые запросы
+    bool is_root_read_ = false;
+    format::DoubleStyle number_style_;
 
-    std::tuple<std::string_view, geo::Coordinates, std::map<std::string_view, int>> FillStop(const json::Dict& request_map) const;
-    void FillStopDistances(transport::Catalogue& catalogue) const;
-    std::tuple<std::string_view, std::vector<const transport::Stop*>, bool> FillRoute(const json::Dict& request_map, transport::Catalogue& catalogue) const;
+    std::tuple<std::string_view, geo::Coordinates, std::map<std::string_view, int>> FillStop(const json::FlatDict& request_map) const;
+    void FillCatalogue(json::StreamReader& reader, transport::Catalogue& catalogue) const;
+    void ProcessStatRequestsParallel(const RequestHandler& rh, json::Writer& writer, std::ostream& output, size_t threads_count);
+    // Дочитывает корневой словарь входа в root_ до ключа section. Возвращает true, если reader остановлен
+    // на значении section, которое не сохраняется; false, если словарь закончился. Пустой section дочитывает словарь целиком
+    bool ReadRootMembers(json::StreamReader& reader, std::string_view section);
+    void PrintNotFound(int id, json::Writer& writer) const;
+    void PrintError(int id, std::string_view message, json::Writer& writer) const;
+    // Ответ с картой: SVG-строка в "map" или, если в запросе "encoding": "gzip", сжатый SVG в base64 в "map_gzip".
+    // Уже сжатую карту можно передать в svg_gzip. На неизвестную кодировку отвечает ошибкой
+    void PrintMapText(const json::FlatDict& request_map, int id, std::string_view svg_text, json::Writer& writer,
+        std::string_view svg_gzip = {}) const;
+    // Прямоугольник и размеры из запроса Map; nullopt, если запрошена вся карта
+    std::optional<renderer::MapView> FillMapView(const json::FlatDict& request_map) const;
+    std::tuple<std::string_view, std::vector<const transport::Stop*>, bool> FillRoute(const json::FlatDict& request_map, transport::Catalogue& catalogue) const;
 };
\ No newline at end of file
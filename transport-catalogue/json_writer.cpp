@@ -0,0 +1,190 @@
+#include "json_writer.h"
+
+#include <stdexcept>
+
+namespace json {
+
+using namespace std::literals;
+
+Writer::Writer(format::DoubleStyle double_style, Layout layout)
+    : double_style_(double_style)
+    , layout_(layout) {
+}
+
+Writer& Writer::BeginObject() {
+    BeginValue();
+    buffer_ += '{';
+    PrintNewLine();
+    stack_.push_back({ true, false });
+    return *this;
+}
+
+Writer& Writer::EndObject() {
+    if (stack_.empty() || !stack_.back().is_dict || after_key_) {
+        throw std::logic_error("EndObject() outside of dict"s);
+    }
+    stack_.pop_back();
+    PrintNewLine();
+    PrintIndent();
+    buffer_ += '}';
+    return *this;
+}
+
+Writer& Writer::BeginArray() {
+    BeginValue();
+    buffer_ += '[';
+    PrintNewLine();
+    stack_.push_back({ false, false });
+    return *this;
+}
+
+Writer& Writer::EndArray() {
+    if (stack_.empty() || stack_.back().is_dict) {
+        throw std::logic_error("EndArray() outside of array"s);
+    }
+    stack_.pop_back();
+    PrintNewLine();
+    PrintIndent();
+    buffer_ += ']';
+    return *this;
+}
+
+Writer& Writer::Key(std::string_view key) {
+    if (stack_.empty() || !stack_.back().is_dict || after_key_) {
+        throw std::logic_error("Wrong map key: "s + std::string(key));
+    }
+    StartItem();
+    PrintString(key);
+    buffer_ += layout_ == Layout::INDENTED ? ": "sv : ":"sv;
+    after_key_ = true;
+    return *this;
+}
+
+Writer& Writer::Int(int value) {
+    BeginValue();
+    format::AppendInt(buffer_, value);
+    return *this;
+}
+
+Writer& Writer::Double(double value) {
+    BeginValue();
+    format::AppendDouble(buffer_, value, double_style_);
+    return *this;
+}
+
+Writer& Writer::String(std::string_view value) {
+    BeginValue();
+    PrintString(value);
+    return *this;
+}
+
+Writer& Writer::Bool(bool value) {
+    BeginValue();
+    buffer_ += value ? "true"sv : "false"sv;
+    return *this;
+}
+
+Writer& Writer::Null() {
+    BeginValue();
+    buffer_ += "null"sv;
+    return *this;
+}
+
+Writer& Writer::ArrayItems(const Writer& other) {
+    if (stack_.size() != 1 || stack_.back().is_dict || after_key_
+        || other.stack_.size() != 1 || other.stack_.back().is_dict || other.layout_ != layout_) {
+        throw std::logic_error("ArrayItems() outside of top-level array"s);
+    }
+    if (!other.stack_.back().has_items) {
+        return *this;
+    }
+    // Буфер other начинается с "[\n" (или "[" в COMPACT), за которым идут элементы с отступами и разделителями
+    const size_t array_start_size = layout_ == Layout::INDENTED ? 2 : 1;
+    if (stack_.back().has_items) {
+        buffer_ += ',';
+        PrintNewLine();
+    }
+    stack_.back().has_items = true;
+    buffer_.append(other.buffer_, array_start_size, std::string::npos);
+    return *this;
+}
+
+std::string_view Writer::GetBuffer() const {
+    return buffer_;
+}
+
+void Writer::Flush(std::ostream& output) {
+    output.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    buffer_.clear();
+}
+
+void Writer::Clear() {
+    buffer_.clear();
+    stack_.clear();
+    after_key_ = false;
+}
+
+void Writer::BeginValue() {
+    if (after_key_) {
+        after_key_ = false;
+        return;
+    }
+    if (stack_.empty()) {
+        return;
+    }
+    if (stack_.back().is_dict) {
+        throw std::logic_error("Value in dict without key"s);
+    }
+    StartItem();
+}
+
+void Writer::StartItem() {
+    if (stack_.back().has_items) {
+        buffer_ += ',';
+        PrintNewLine();
+    }
+    else {
+        stack_.back().has_items = true;
+    }
+    PrintIndent();
+}
+
+void Writer::PrintNewLine() {
+    if (layout_ == Layout::INDENTED) {
+        buffer_ += '\n';
+    }
+}
+
+void Writer::PrintIndent() {
+    if (layout_ == Layout::INDENTED) {
+        buffer_.append(stack_.size() * 4, ' ');
+    }
+}
+
+void Writer::PrintString(std::string_view value) {
+    buffer_ += '"';
+    // Участки без экранируемых символов копируются целиком: длинные строки вроде карты
+    // переносятся в буфер несколькими крупными append вместо посимвольной записи
+    size_t start = 0;
+    for (size_t pos = value.find_first_of("\r\n\"\\"sv); pos != std::string_view::npos;
+        pos = value.find_first_of("\r\n\"\\"sv, start)) {
+        buffer_.append(value.substr(start, pos - start));
+        switch (value[pos]) {
+        case '\r':
+            buffer_ += "\\r"sv;
+            break;
+        case '\n':
+            buffer_ += "\\n"sv;
+            break;
+        default:
+            buffer_ += '\\';
+            buffer_ += value[pos];
+            break;
+        }
+        start = pos + 1;
+    }
+    buffer_.append(value.substr(start));
+    buffer_ += '"';
+}
+
+}
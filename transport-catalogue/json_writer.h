@@ -0,0 +1,67 @@
+#pragma once
+
+#include "format.h"
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace json {
+
+// Пишет JSON сразу в текстовый буфер в том же формате, что и json::Print, не создавая Node.
+// Ключи словаря выводятся в порядке вызовов Key, поэтому для совпадения с Print их нужно
+// передавать в лексикографическом порядке. Буфер переиспользуется между вызовами Flush.
+// По умолчанию числа с плавающей точкой выводятся так же, как в json::Print
+class Writer {
+public:
+    // INDENTED повторяет отступы json::Print, COMPACT пишет значение в одну строку без пробелов
+    enum class Layout {
+        INDENTED,
+        COMPACT,
+    };
+
+    explicit Writer(format::DoubleStyle double_style = {}, Layout layout = Layout::INDENTED);
+
+    Writer& BeginObject();
+    Writer& EndObject();
+    Writer& BeginArray();
+    Writer& EndArray();
+    Writer& Key(std::string_view key);
+
+    Writer& Int(int value);
+    Writer& Double(double value);
+    Writer& String(std::string_view value);
+    Writer& Bool(bool value);
+    Writer& Null();
+
+    // Дописывает элементы массива верхнего уровня, записанные другим Writer после его BeginArray.
+    // Так ответы, подготовленные в разных буферах, склеиваются в нужном порядке
+    Writer& ArrayItems(const Writer& other);
+
+    std::string_view GetBuffer() const;
+    // Выводит накопленный текст и очищает буфер, сохраняя его ёмкость
+    void Flush(std::ostream& output);
+    // Отбрасывает накопленный текст и незакрытые словари и массивы
+    void Clear();
+
+private:
+    struct Context {
+        bool is_dict;
+        bool has_items;
+    };
+
+    std::string buffer_;
+    format::DoubleStyle double_style_;
+    Layout layout_;
+    std::vector<Context> stack_;
+    bool after_key_ = false;
+
+    void BeginValue();
+    void StartItem();
+    void PrintNewLine();
+    void PrintIndent();
+    void PrintString(std::string_view value);
+};
+
+}
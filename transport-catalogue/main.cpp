@@ -1,51 +1,269 @@
+#include <algorithm>
+#include <charconv>
+#include <csignal>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
 #include <string_view>
+#include <system_error>
+#include <thread>
 
 #include "transport_catalogue.h"
+#include "binary_reader.h"
+#include "gzip_stream.h"
 #include "json_reader.h"
 #include "serialization.h"
+#include "server.h"
 
 using namespace std::literals;
 
 void PrintUsage(std::ostream& stream = std::cerr) {
-    stream << "Usage: transport_catalogue [make_base|process_requests]\n"sv;
+    stream << "Usage: transport_catalogue [make_base|update_base|process_requests [--threads N] [--format=json|binary] [--compress=gzip] [--numbers=FORMAT]|serve SETTINGS_FILE [--socket PATH] [--numbers=FORMAT]]\n"sv;
+}
+
+// Пишет базу во временный файл и подменяет им file одним переименованием: запущенный serve
+// не прочитает её наполовину записанной. Если запись не удалась, временный файл удаляется,
+// а прежняя база остаётся на месте
+bool WriteBase(const std::string& file, const transport::Catalogue& catalogue, const renderer::MapRenderer& renderer,
+    const transport::Router& router) {
+    const std::string tmp_file = file + ".tmp"s;
+    try {
+        std::ofstream fout(tmp_file, std::ios::binary);
+        if (!fout) {
+            throw std::runtime_error("Cannot open "s + tmp_file);
+        }
+        serialization::Serialize(catalogue, renderer, router, fout);
+        fout.close();
+        if (!fout) {
+            throw std::runtime_error("Error writing "s + tmp_file);
+        }
+        std::filesystem::rename(tmp_file, file);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        std::error_code ec;
+        std::filesystem::remove(tmp_file, ec);
+        return false;
+    }
+    return true;
 }
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
+    if (argc < 2) {
         PrintUsage();
         return 1;
     }
 
     const std::string_view mode(argv[1]);
 
+    // serve первым аргументом получает JSON-файл с serialization_settings:
+    // стандартный вход в этом режиме занят запросами
+    int options_start = 2;
+    std::string settings_file;
+    if (mode == "serve"sv) {
+        if (argc < 3) {
+            PrintUsage();
+            return 1;
+        }
+        settings_file = argv[2];
+        options_start = 3;
+    }
+
+    // --threads N: число потоков для stat_requests, 0 — по числу ядер.
+    // --format=binary: process_requests читает и пишет сообщения из stat_requests.proto вместо JSON.
+    // --compress=gzip: process_requests сжимает весь вывод в gzip по мере записи ответов.
+    // --socket PATH: serve принимает запросы на Unix domain socket вместо стандартного входа.
+    // --numbers=compatible|shortest|fixed:N: вывод чисел с плавающей точкой в JSON-ответах
+    size_t threads_count = 1;
+    bool is_binary = false;
+    bool is_gzip = false;
+    std::string socket_path;
+    format::DoubleStyle number_style;
+    for (int i = options_start; i < argc; ++i) {
+        const std::string_view option(argv[i]);
+        if ((option == "--format=binary"sv || option == "--format=json"sv) && mode == "process_requests"sv) {
+            is_binary = option == "--format=binary"sv;
+            continue;
+        }
+        if (option == "--compress=gzip"sv && mode == "process_requests"sv) {
+            is_gzip = true;
+            continue;
+        }
+        if (constexpr std::string_view numbers_prefix = "--numbers="sv; option.substr(0, numbers_prefix.size()) == numbers_prefix
+            && (mode == "process_requests"sv || mode == "serve"sv)) {
+            const auto style = format::ParseDoubleStyle(option.substr(numbers_prefix.size()));
+            if (!style) {
+                PrintUsage();
+                return 1;
+            }
+            number_style = *style;
+            continue;
+        }
+        if (i + 1 == argc) {
+            PrintUsage();
+            return 1;
+        }
+        const std::string_view value(argv[++i]);
+        if (option == "--threads"sv && mode == "process_requests"sv) {
+            if (const auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), threads_count);
+                ec != std::errc{} || ptr != value.data() + value.size()) {
+                PrintUsage();
+                return 1;
+            }
+            if (threads_count == 0) {
+                threads_count = std::max(1u, std::thread::hardware_concurrency());
+            }
+        }
+        else if (option == "--socket"sv && mode == "serve"sv) {
+            socket_path = value;
+        }
+        else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    // Сжатие идёт в отдельном потоке одновременно с обработкой следующих запросов
+    std::unique_ptr<gzip::OStream> gzip_output;
+    if (is_gzip) {
+        gzip_output = std::make_unique<gzip::OStream>(std::cout);
+    }
+    std::ostream& output = gzip_output ? *gzip_output : std::cout;
+
     if (mode == "make_base"sv) {
-        JsonReader json_input(std::cin);
+        // base_requests разбираются поэлементно прямо в справочник, без полного дерева документа
         transport::Catalogue catalogue;
-        json_input.FillCatalogue(catalogue);
+        JsonReader json_input(std::cin, catalogue);
+        catalogue.Freeze();
 
         const auto& routing_settings = json_input.FillRoutingSettings(json_input.GetRoutingSettings());
         const transport::Router router = { routing_settings, catalogue };
         const auto& render_settings = json_input.GetRenderSettings();
         const renderer::MapRenderer renderer = json_input.FillRenderSettings(render_settings);
         const auto& serialization_settings = json_input.GetSerializationSettings();
-        
-        std::ofstream fout(serialization_settings.AsDict().at("file"s).AsString(), std::ios::binary);
-        if (fout.is_open()) {
-            serialization::Serialize(catalogue, renderer, router, fout);
+        if (!WriteBase(std::string(serialization_settings.AsDict().at("file"sv).AsString()), catalogue, renderer, router)) {
+            return 1;
         }
-}
+    }
+    else if (mode == "update_base"sv) {
+        // Ошибка в правках (например, удаление остановки, через которую ещё идут маршруты)
+        // оставляет прежнюю базу нетронутой
+        try {
+            JsonReader json_input(std::cin);
+            const std::string file(json_input.GetSerializationSettings().AsDict().at("file"sv).AsString());
+            std::ifstream db_file(file, std::ios::binary);
+            if (db_file) {
+                auto [catalogue, renderer, router, graph, stop_ids] = serialization::Deserialize(db_file);
+                db_file.close();
+                auto changed_buses = json_input.UpdateCatalogue(catalogue);
+                catalogue.Freeze();
+
+                if (!json_input.GetRoutingSettings().IsNull()) {
+                    // Новые параметры маршрутизации меняют веса всех рёбер
+                    router = json_input.FillRoutingSettings(json_input.GetRoutingSettings());
+                    for (const auto& [bus_number, bus] : catalogue.GetSortedAllBuses()) {
+                        changed_buses.emplace(bus_number);
+                    }
+                }
+                router.UpdateGraph(catalogue, graph, stop_ids, changed_buses);
+                const renderer::MapRenderer updated_renderer = json_input.GetRenderSettings().IsNull()
+                    ? std::move(renderer)
+                    : json_input.FillRenderSettings(json_input.GetRenderSettings());
+
+                if (!WriteBase(file, catalogue, updated_renderer, router)) {
+                    return 1;
+                }
+            }
+            else {
+                std::cerr << "Cannot open base file "sv << file << '\n';
+                return 1;
+            }
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << '\n';
+            return 1;
+        }
+    }
+    else if (mode == "process_requests"sv && is_binary) {
+        // Двоичные запросы выполняются последовательно, --threads относится только к JSON
+        try {
+            BinaryReader binary_input(std::cin);
+            std::ifstream db_file(binary_input.GetSerializationSettings().file(), std::ios::binary);
+            if (db_file) {
+                const auto snapshot = serialization::DeserializeSnapshot(db_file);
+                RequestHandler rh(*snapshot);
+
+                binary_input.ProcessStatRequests(rh, output);
+            }
+            if (gzip_output) {
+                gzip_output->Finish();
+            }
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << '\n';
+            return 1;
+        }
+    }
     else if (mode == "process_requests"sv) {
-        JsonReader json_input(std::cin);
-        std::ifstream db_file(json_input.GetSerializationSettings().AsDict().at("file"s).AsString(), std::ios::binary);
+        // Ответы выводятся по мере обработки запросов, без общего массива ответов
+        JsonReader json_input(std::cin, StatRequestsMode::STREAM);
+        json_input.SetNumberStyle(number_style);
+        std::ifstream db_file(std::string(json_input.GetSerializationSettings().AsDict().at("file"sv).AsString()), std::ios::binary);
         if (db_file) {
-            auto [catalogue, renderer, router, graph, stop_ids] = serialization::Deserialize(db_file);
-            const auto& stat_requests = json_input.GetStatRequests();
-            router.SetGraph(graph, stop_ids);
-            RequestHandler rh = { catalogue, renderer, router };
+            const auto snapshot = serialization::DeserializeSnapshot(db_file);
+            RequestHandler rh(*snapshot);
             
-            json_input.ProcessRequests(stat_requests, rh);
+            json_input.ProcessStatRequests(rh, output, threads_count);
+        }
+        if (gzip_output) {
+            try {
+                gzip_output->Finish();
+            }
+            catch (const std::exception& e) {
+                std::cerr << e.what() << '\n';
+                return 1;
+            }
+        }
+    }
+    else if (mode == "serve"sv) {
+        // База загружается один раз, дальше каждый запрос обходится без десериализации
+        std::ifstream settings(settings_file);
+        if (!settings) {
+            std::cerr << "Cannot open "sv << settings_file << '\n';
+            return 1;
+        }
+        JsonReader json_input(settings);
+        json_input.SetNumberStyle(number_style);
+        try {
+            // База перечитывается по SIGHUP и при изменении файла, запросы при этом не прерываются
+            server::BaseReloader reloader(std::string(json_input.GetSerializationSettings().AsDict().at("file"sv).AsString()), std::cerr);
+#ifdef SIGHUP
+            std::signal(SIGHUP, [](int) {
+                server::BaseReloader::RequestReload();
+            });
+#endif
+            reloader.Watch(std::chrono::seconds(1));
+
+            if (socket_path.empty()) {
+                std::ios::sync_with_stdio(false);
+                server::ServeStream(json_input, reloader.GetStore(), std::cin, std::cout);
+            }
+            else {
+                // По SIGINT и SIGTERM сервер дожидается начатых соединений и удаляет файл сокета
+                for (const int signal_number : { SIGINT, SIGTERM }) {
+                    std::signal(signal_number, [](int) {
+                        server::StopServing();
+                    });
+                }
+                server::ServeSocket(json_input, reloader.GetStore(), socket_path);
+            }
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << '\n';
+            return 1;
         }
     }
     else {
@@ -0,0 +1,154 @@
+#include "map_index.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace renderer {
+
+namespace {
+
+geo::BoundingBox PointBox(geo::Coordinates point) {
+    return { point, point };
+}
+
+void Extend(geo::BoundingBox& box, geo::Coordinates point) {
+    box.min.lat = std::min(box.min.lat, point.lat);
+    box.min.lng = std::min(box.min.lng, point.lng);
+    box.max.lat = std::max(box.max.lat, point.lat);
+    box.max.lng = std::max(box.max.lng, point.lng);
+}
+
+}  // namespace
+
+MapIndex::MapIndex(const transport::RouteGeometry& geometry) {
+    size_t stops_count = 0;
+    for (size_t stop = 0; stop < geometry.stop_on_route.size(); ++stop) {
+        if (!geometry.stop_on_route[stop]) continue;
+        if (stops_count++ == 0) {
+            bounds_ = PointBox(geometry.StopCoordinates(stop));
+        }
+        else {
+            Extend(bounds_, geometry.StopCoordinates(stop));
+        }
+    }
+    if (stops_count == 0) {
+        return;
+    }
+
+    // В среднем по одной остановке на ячейку
+    columns_ = rows_ = std::max<size_t>(1, static_cast<size_t>(std::sqrt(static_cast<double>(stops_count))));
+    cell_lat_ = (bounds_.max.lat - bounds_.min.lat) / static_cast<double>(rows_);
+    cell_lng_ = (bounds_.max.lng - bounds_.min.lng) / static_cast<double>(columns_);
+
+    // Обратный путь некольцевого маршрута проходит по тем же перегонам, поэтому берётся только прямой
+    for (size_t bus = 0; bus < geometry.BusCount(); ++bus) {
+        const size_t* stops_begin = geometry.BusStopsBegin(bus);
+        const size_t* stops_end = geometry.BusStopsEnd(bus);
+        if (stops_begin == stops_end) continue;
+        if (stops_end - stops_begin == 1) {
+            segments_.push_back({ bus, PointBox(geometry.StopCoordinates(*stops_begin)) });
+            continue;
+        }
+        for (const size_t* stop = stops_begin + 1; stop != stops_end; ++stop) {
+            geo::BoundingBox box = PointBox(geometry.StopCoordinates(*(stop - 1)));
+            Extend(box, geometry.StopCoordinates(*stop));
+            segments_.push_back({ bus, box });
+        }
+    }
+
+    // Ячейки заполняются в два прохода: сначала подсчёт, затем раскладка по смещениям
+    const size_t cells_count = columns_ * rows_;
+    const auto for_each_segment_cell = [this](const Segment& segment, auto action) {
+        for (size_t row = Row(segment.box.min.lat); row <= Row(segment.box.max.lat); ++row) {
+            for (size_t column = Column(segment.box.min.lng); column <= Column(segment.box.max.lng); ++column) {
+                action(row * columns_ + column);
+            }
+        }
+    };
+
+    stop_offsets_.assign(cells_count + 1, 0);
+    segment_offsets_.assign(cells_count + 1, 0);
+    for (size_t stop = 0; stop < geometry.stop_on_route.size(); ++stop) {
+        if (!geometry.stop_on_route[stop]) continue;
+        const geo::Coordinates point = geometry.StopCoordinates(stop);
+        ++stop_offsets_[Row(point.lat) * columns_ + Column(point.lng) + 1];
+    }
+    for (const Segment& segment : segments_) {
+        for_each_segment_cell(segment, [this](size_t cell) {
+            ++segment_offsets_[cell + 1];
+        });
+    }
+    for (size_t cell = 0; cell < cells_count; ++cell) {
+        stop_offsets_[cell + 1] += stop_offsets_[cell];
+        segment_offsets_[cell + 1] += segment_offsets_[cell];
+    }
+
+    stop_ids_.resize(stop_offsets_.back());
+    segment_ids_.resize(segment_offsets_.back());
+    std::vector<size_t> stop_positions(stop_offsets_.begin(), stop_offsets_.end() - 1);
+    std::vector<size_t> segment_positions(segment_offsets_.begin(), segment_offsets_.end() - 1);
+    for (size_t stop = 0; stop < geometry.stop_on_route.size(); ++stop) {
+        if (!geometry.stop_on_route[stop]) continue;
+        const geo::Coordinates point = geometry.StopCoordinates(stop);
+        stop_ids_[stop_positions[Row(point.lat) * columns_ + Column(point.lng)]++] = stop;
+    }
+    for (size_t segment = 0; segment < segments_.size(); ++segment) {
+        for_each_segment_cell(segments_[segment], [this, &segment_positions, segment](size_t cell) {
+            segment_ids_[segment_positions[cell]++] = segment;
+        });
+    }
+}
+
+MapSelection MapIndex::Select(const transport::RouteGeometry& geometry, const geo::BoundingBox& box) const {
+    MapSelection result;
+    if (columns_ == 0 || !bounds_.Intersects(box)) {
+        return result;
+    }
+
+    for (size_t row = Row(box.min.lat); row <= Row(box.max.lat); ++row) {
+        for (size_t column = Column(box.min.lng); column <= Column(box.max.lng); ++column) {
+            const size_t cell = row * columns_ + column;
+            for (size_t i = stop_offsets_[cell]; i < stop_offsets_[cell + 1]; ++i) {
+                const size_t stop = stop_ids_[i];
+                if (box.Contains(geometry.StopCoordinates(stop))) {
+                    result.stops.push_back(stop);
+                }
+            }
+            // Перегон, задевающий несколько ячеек, и маршрут из нескольких перегонов находятся
+            // несколько раз: повторы убираются ниже
+            for (size_t i = segment_offsets_[cell]; i < segment_offsets_[cell + 1]; ++i) {
+                const Segment& segment = segments_[segment_ids_[i]];
+                if (segment.box.Intersects(box)) {
+                    result.buses.push_back(segment.bus);
+                }
+            }
+        }
+    }
+    // Каждая остановка лежит ровно в одной ячейке, поэтому остановки без повторов
+    std::sort(result.buses.begin(), result.buses.end());
+    result.buses.erase(std::unique(result.buses.begin(), result.buses.end()), result.buses.end());
+    std::sort(result.stops.begin(), result.stops.end(), [&geometry](size_t lhs, size_t rhs) {
+        return geometry.stop_name_ranks[lhs] < geometry.stop_name_ranks[rhs];
+    });
+    return result;
+}
+
+const geo::BoundingBox& MapIndex::GetBounds() const {
+    return bounds_;
+}
+
+size_t MapIndex::Column(double lng) const {
+    if (cell_lng_ <= 0.0 || lng <= bounds_.min.lng) {
+        return 0;
+    }
+    return std::min(columns_ - 1, static_cast<size_t>((lng - bounds_.min.lng) / cell_lng_));
+}
+
+size_t MapIndex::Row(double lat) const {
+    if (cell_lat_ <= 0.0 || lat <= bounds_.min.lat) {
+        return 0;
+    }
+    return std::min(rows_ - 1, static_cast<size_t>((lat - bounds_.min.lat) / cell_lat_));
+}
+
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "domain.h"
+#include "geo.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace renderer {
+
+// Видимая часть сети: индексы RouteGeometry маршрутов по возрастанию номеров и остановок
+// по возрастанию названий — в том порядке, в каком они выводятся на карту
+struct MapSelection {
+    std::vector<size_t> buses;
+    std::vector<size_t> stops;
+};
+
+/*
+    * Пространственный индекс карты: равномерная сетка над прямоугольником всех остановок маршрутов.
+    * В ячейке лежат остановки, попавшие в неё, и перегоны маршрутов, чей прямоугольник
+    * задевает ячейку. Запрос просматривает только ячейки, пересекающие заданный прямоугольник,
+    * поэтому время отбора растёт с видимой площадью, а не с размером сети.
+    * Строится один раз по неизменяемой RouteGeometry и дальше только читается
+    */
+class MapIndex {
+public:
+    MapIndex() = default;
+    explicit MapIndex(const transport::RouteGeometry& geometry);
+
+    // Маршруты, хотя бы один перегон которых задевает box, и остановки маршрутов внутри box.
+    // Просматриваются только ячейки под box, память под результат — по числу найденного
+    MapSelection Select(const transport::RouteGeometry& geometry, const geo::BoundingBox& box) const;
+    // Прямоугольник всех остановок маршрутов
+    const geo::BoundingBox& GetBounds() const;
+
+private:
+    struct Segment {
+        size_t bus;
+        geo::BoundingBox box;
+    };
+
+    geo::BoundingBox bounds_{};
+    size_t columns_ = 0;
+    size_t rows_ = 0;
+    double cell_lat_ = 0.0;
+    double cell_lng_ = 0.0;
+
+    std::vector<Segment> segments_;
+    // Содержимое ячейки cell — stop_ids_[stop_offsets_[cell] .. stop_offsets_[cell + 1])
+    // и segment_ids_[segment_offsets_[cell] .. segment_offsets_[cell + 1])
+    std::vector<size_t> stop_offsets_;
+    std::vector<size_t> stop_ids_;
+    std::vector<size_t> segment_offsets_;
+    std::vector<size_t> segment_ids_;
+
+    size_t Column(double lng) const;
+    size_t Row(double lat) const;
+};
+
+}
@@ -6,144 +6,624 @@ bool IsZero(double value) {
     return std::abs(value) < EPSILON;
 }
 
-std::vector<svg::Polyline> MapRenderer::GetRouteLines(const std::map<std::string_view, const transport::Bus*>& buses, const SphereProjector& sp) const {
-    std::vector<svg::Polyline> result;
-    size_t color_num = 0;
-    for (const auto& [bus_number, bus] : buses) {
-        if (bus->stops.empty()) continue;
-        std::vector<const transport::Stop*> route_stops{ bus->stops.begin(), bus->stops.end() };
-        if (bus->is_circle == false) route_stops.insert(route_stops.end(), std::next(bus->stops.rbegin()), bus->stops.rend());
-        svg::Polyline line;
-        for (const auto& stop : route_stops) {
-            line.AddPoint(sp(stop->coordinates));
-        }
-        line.SetStrokeColor(render_settings_.color_palette[color_num]);
+namespace {
+
+// Квадрат расстояния от точки до отрезка [a, b]
+double SquaredDistanceToSegment(svg::Point point, svg::Point a, svg::Point b) {
+    const double dx = b.x - a.x;
+    const double dy = b.y - a.y;
+    const double length_squared = dx * dx + dy * dy;
+    double t = 0.0;
+    if (length_squared > 0.0) {
+        t = std::clamp(((point.x - a.x) * dx + (point.y - a.y) * dy) / length_squared, 0.0, 1.0);
+    }
+    const double px = a.x + t * dx - point.x;
+    const double py = a.y + t * dy - point.y;
+    return px * px + py * py;
+}
+
+// Упрощение Дугласа — Пеккера: оставляет концы ломаной и точки, без которых она
+// отклонится от исходной больше чем на tolerance. Отрезки обходятся через стек, а не рекурсией
+void SimplifyPolyline(std::vector<svg::Point>& points, double tolerance) {
+    if (points.size() < 3) {
+        return;
+    }
+    const double tolerance_squared = tolerance * tolerance;
+    std::vector<uint8_t> kept(points.size(), 0);
+    kept.front() = kept.back() = 1;
+    std::vector<std::pair<size_t, size_t>> ranges = { { 0, points.size() - 1 } };
+    while (!ranges.empty()) {
+        const auto [first, last] = ranges.back();
+        ranges.pop_back();
+        double max_distance = 0.0;
+        size_t farthest = first;
+        for (size_t i = first + 1; i < last; ++i) {
+            const double distance = SquaredDistanceToSegment(points[i], points[first], points[last]);
+            if (distance > max_distance) {
+                max_distance = distance;
+                farthest = i;
+            }
+        }
+        if (max_distance > tolerance_squared) {
+            kept[farthest] = 1;
+            ranges.push_back({ first, farthest });
+            ranges.push_back({ farthest, last });
+        }
+    }
+    size_t count = 0;
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (kept[i]) {
+            points[count++] = points[i];
+        }
+    }
+    points.resize(count);
+}
+
+bool IsInBox(svg::Point point, svg::Point min, svg::Point max) {
+    return point.x >= min.x && point.x <= max.x && point.y >= min.y && point.y <= max.y;
+}
+
+// Обрезает ломаную по прямоугольнику [min, max] (алгоритм Лианга — Барски) и возвращает
+// её видимые участки. Внутри прямоугольника линия проходит так же, как исходная
+std::vector<std::vector<svg::Point>> ClipPolyline(const std::vector<svg::Point>& points, svg::Point min, svg::Point max) {
+    std::vector<std::vector<svg::Point>> result;
+    if (points.size() == 1) {
+        if (IsInBox(points.front(), min, max)) {
+            result.push_back(points);
+        }
+        return result;
+    }
+    bool is_open = false;
+    for (size_t i = 1; i < points.size(); ++i) {
+        const svg::Point a = points[i - 1];
+        const svg::Point b = points[i];
+        const double dx = b.x - a.x;
+        const double dy = b.y - a.y;
+        double t_enter = 0.0;
+        double t_leave = 1.0;
+        // Для каждой стороны прямоугольника: p — скорость приближения к ней изнутри, q — запас до неё в точке a
+        const std::pair<double, double> sides[] = { { -dx, a.x - min.x }, { dx, max.x - a.x }, { -dy, a.y - min.y }, { dy, max.y - a.y } };
+        bool is_visible = true;
+        for (const auto& [p, q] : sides) {
+            if (p == 0.0) {
+                is_visible = is_visible && q >= 0.0;
+            }
+            else if (p < 0.0) {
+                t_enter = std::max(t_enter, q / p);
+            }
+            else {
+                t_leave = std::min(t_leave, q / p);
+            }
+        }
+        if (!is_visible || t_enter > t_leave) {
+            is_open = false;
+            continue;
+        }
+        if (!is_open || t_enter > 0.0) {
+            result.push_back({ t_enter > 0.0 ? svg::Point{ a.x + t_enter * dx, a.y + t_enter * dy } : a });
+        }
+        result.back().push_back(t_leave < 1.0 ? svg::Point{ a.x + t_leave * dx, a.y + t_leave * dy } : b);
+        is_open = t_leave == 1.0;
+    }
+    return result;
+}
+
+// 64-битный FNV-1a: не зависит от реализации std::hash, поэтому ключи, сохранённые в базе, совпадают между сборками
+constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+uint64_t HashBytes(std::string_view bytes, uint64_t hash = FNV_OFFSET_BASIS) {
+    for (const char c : bytes) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+template <typename Value>
+void AppendKeyBytes(std::string& key, const Value& value) {
+    key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void AppendKeyBytes(std::string& key, svg::Point point) {
+    AppendKeyBytes(key, point.x);
+    AppendKeyBytes(key, point.y);
+}
+
+}  // namespace
+
+std::vector<svg::Point> MapRenderer::ProjectStops(const transport::RouteGeometry& geometry, const SphereProjector& sp) const {
+    std::vector<svg::Point> result(geometry.stop_on_route.size());
+    for (size_t stop = 0; stop < geometry.stop_on_route.size(); ++stop) {
+        if (geometry.stop_on_route[stop]) {
+            result[stop] = sp(geometry.StopCoordinates(stop));
+        }
+    }
+    return result;
+}
+
+template <typename StopPoint>
+std::vector<svg::Point> MapRenderer::GetBusPoints(const transport::RouteGeometry& geometry, const StopPoint& stop_point, size_t bus,
+    double simplify_tolerance) const {
+    const size_t* stops_begin = geometry.BusStopsBegin(bus);
+    const size_t* stops_end = geometry.BusStopsEnd(bus);
+    std::vector<svg::Point> points;
+    points.reserve(2 * static_cast<size_t>(stops_end - stops_begin));
+    for (const size_t* stop = stops_begin; stop != stops_end; ++stop) {
+        points.push_back(stop_point(*stop));
+    }
+    if (simplify_tolerance > 0.0) {
+        // Обратный путь некольцевого маршрута обводит тот же след с круглыми стыками,
+        // поэтому при упрощении рисуется только прямой путь
+        SimplifyPolyline(points, simplify_tolerance);
+    }
+    else if (!geometry.bus_is_circle[bus]) {
+        for (const size_t* stop = stops_end - 1; stop != stops_begin; --stop) {
+            points.push_back(stop_point(*(stop - 1)));
+        }
+    }
+    return points;
+}
+
+template <typename StopPoint>
+svg::Polyline MapRenderer::GetBusLine(const transport::RouteGeometry& geometry, const StopPoint& stop_point, size_t bus,
+    double simplify_tolerance) const {
+    return GetRouteLine(GetBusPoints(geometry, stop_point, bus, simplify_tolerance), GetBusColor(geometry, bus));
+}
+
+svg::Polyline MapRenderer::GetRouteLine(const std::vector<svg::Point>& points, size_t color_num) const {
+    svg::Polyline line;
+    for (const auto& point : points) {
+        line.AddPoint(point);
+    }
+    line.SetStrokeColor(render_settings_.color_palette[color_num]);
+    if (render_settings_.compact_svg) {
+        line.SetClass("l");
+    }
+    else {
         line.SetFillColor("none");
         line.SetStrokeWidth(render_settings_.line_width);
         line.SetStrokeLineCap(svg::StrokeLineCap::ROUND);
         line.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
-
-        if (color_num < (render_settings_.color_palette.size() - 1)) ++color_num;
-        else color_num = 0;
-
-        result.push_back(line);
     }
+    return line;
+}
 
-    return result;
+size_t MapRenderer::GetBusColor(const transport::RouteGeometry& geometry, size_t bus) const {
+    // Цвета раздаются по кругу маршрутам с остановками в порядке номеров
+    return geometry.bus_color_ranks[bus] % render_settings_.color_palette.size();
 }
 
-std::vector<svg::Text> MapRenderer::GetBusLabel(const std::map<std::string_view, const transport::Bus*>& buses, const SphereProjector& sp) const {
-    std::vector<svg::Text> result;
-    size_t color_num = 0;
-    for (const auto& [bus_number, bus] : buses) {
-        if (bus->stops.empty()) continue;
-        svg::Text text;
-        svg::Text underlayer;
-        text.SetPosition(sp(bus->stops[0]->coordinates));
-        text.SetOffset(render_settings_.bus_label_offset);
-        text.SetFontSize(render_settings_.bus_label_font_size);
+template <typename StopPoint>
+void MapRenderer::AddBusLabels(const transport::RouteGeometry& geometry, const StopPoint& stop_point, size_t bus,
+    std::vector<svg::Text>& result, const ClipBox* clip) const {
+    const size_t first_stop = *geometry.BusStopsBegin(bus);
+    const size_t last_stop = *(geometry.BusStopsEnd(bus) - 1);
+    svg::Text text;
+    svg::Text underlayer;
+    text.SetPosition(stop_point(first_stop));
+    text.SetOffset(render_settings_.bus_label_offset);
+    text.SetFontSize(render_settings_.bus_label_font_size);
+    if (render_settings_.compact_svg) {
+        text.SetClass("b");
+    }
+    else {
         text.SetFontFamily("Verdana");
         text.SetFontWeight("bold");
-        text.SetData(bus->number);
-        text.SetFillColor(render_settings_.color_palette[color_num]);
-        if (color_num < (render_settings_.color_palette.size() - 1)) ++color_num;
-        else color_num = 0;
-
-        underlayer.SetPosition(sp(bus->stops[0]->coordinates));
-        underlayer.SetOffset(render_settings_.bus_label_offset);
-        underlayer.SetFontSize(render_settings_.bus_label_font_size);
+    }
+    text.SetData(geometry.buses[bus]->number);
+    text.SetFillColor(render_settings_.color_palette[GetBusColor(geometry, bus)]);
+
+    underlayer.SetPosition(stop_point(first_stop));
+    underlayer.SetOffset(render_settings_.bus_label_offset);
+    underlayer.SetFontSize(render_settings_.bus_label_font_size);
+    underlayer.SetData(geometry.buses[bus]->number);
+    if (render_settings_.compact_svg) {
+        underlayer.SetClass("u b");
+    }
+    else {
         underlayer.SetFontFamily("Verdana");
         underlayer.SetFontWeight("bold");
-        underlayer.SetData(bus->number);
         underlayer.SetFillColor(render_settings_.underlayer_color);
         underlayer.SetStrokeColor(render_settings_.underlayer_color);
         underlayer.SetStrokeWidth(render_settings_.underlayer_width);
         underlayer.SetStrokeLineCap(svg::StrokeLineCap::ROUND);
         underlayer.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
+    }
 
+    if (!clip || IsInBox(stop_point(first_stop), clip->min, clip->max)) {
         result.push_back(underlayer);
         result.push_back(text);
+    }
 
-        if (bus->is_circle == false && bus->stops[0] != bus->stops[bus->stops.size() - 1]) {
-            svg::Text text2 {text};
-            svg::Text underlayer2 {underlayer};
-            text2.SetPosition(sp(bus->stops[bus->stops.size() - 1]->coordinates));
-            underlayer2.SetPosition(sp(bus->stops[bus->stops.size() - 1]->coordinates));
+    if (!geometry.bus_is_circle[bus] && first_stop != last_stop && (!clip || IsInBox(stop_point(last_stop), clip->min, clip->max))) {
+        svg::Text text2 {text};
+        svg::Text underlayer2 {underlayer};
+        text2.SetPosition(stop_point(last_stop));
+        underlayer2.SetPosition(stop_point(last_stop));
 
-            result.push_back(underlayer2);
-            result.push_back(text2);
-        }
+        result.push_back(underlayer2);
+        result.push_back(text2);
     }
-
-    return result;
 }
 
-std::vector<svg::Circle> MapRenderer::GetStopsSymbols(const std::map<std::string_view, const transport::Stop*>& stops, const SphereProjector& sp) const {
-    std::vector<svg::Circle> result;
-    for (const auto& [stop_name, stop] : stops) {
-        svg::Circle symbol;
-        symbol.SetCenter(sp(stop->coordinates));
-        symbol.SetRadius(render_settings_.stop_radius);
+svg::Circle MapRenderer::GetStopSymbol(svg::Point point) const {
+    svg::Circle symbol;
+    symbol.SetCenter(point);
+    symbol.SetRadius(render_settings_.stop_radius);
+    if (render_settings_.compact_svg) {
+        symbol.SetClass("s");
+    }
+    else {
         symbol.SetFillColor("white");
-
-        result.push_back(symbol);
     }
-
-    return result;
+    return symbol;
 }
 
-std::vector<svg::Text> MapRenderer::GetStopsLabels(const std::map<std::string_view, const transport::Stop*>& stops, const SphereProjector& sp) const {
-    std::vector<svg::Text> result;
+void MapRenderer::AddStopLabels(const std::string& name, svg::Point point, std::vector<svg::Text>& result) const {
     svg::Text text;
     svg::Text underlayer;
-    for (const auto& [stop_name, stop] : stops) {
-        text.SetPosition(sp(stop->coordinates));
-        text.SetOffset(render_settings_.stop_label_offset);
-        text.SetFontSize(render_settings_.stop_label_font_size);
+    text.SetPosition(point);
+    text.SetOffset(render_settings_.stop_label_offset);
+    text.SetFontSize(render_settings_.stop_label_font_size);
+    text.SetData(name);
+
+    underlayer.SetPosition(point);
+    underlayer.SetOffset(render_settings_.stop_label_offset);
+    underlayer.SetFontSize(render_settings_.stop_label_font_size);
+    underlayer.SetData(name);
+    if (render_settings_.compact_svg) {
+        text.SetClass("t k");
+        underlayer.SetClass("u t");
+    }
+    else {
         text.SetFontFamily("Verdana");
-        text.SetData(stop->name);
         text.SetFillColor("black");
-
-        underlayer.SetPosition(sp(stop->coordinates));
-        underlayer.SetOffset(render_settings_.stop_label_offset);
-        underlayer.SetFontSize(render_settings_.stop_label_font_size);
         underlayer.SetFontFamily("Verdana");
-        underlayer.SetData(stop->name);
         underlayer.SetFillColor(render_settings_.underlayer_color);
         underlayer.SetStrokeColor(render_settings_.underlayer_color);
         underlayer.SetStrokeWidth(render_settings_.underlayer_width);
         underlayer.SetStrokeLineCap(svg::StrokeLineCap::ROUND);
         underlayer.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
+    }
 
-        result.push_back(underlayer);
-        result.push_back(text);
+    result.push_back(underlayer);
+    result.push_back(text);
+}
+
+svg::Document MapRenderer::GetSVG(const transport::RouteGeometry& geometry) const {
+    const std::vector<svg::Point> stop_points = ProjectStops(geometry, GetMapProjector(geometry));
+    MapSelection selection;
+    for (size_t bus = 0; bus < geometry.BusCount(); ++bus) {
+        if (geometry.BusStopsCount(bus) != 0) selection.buses.push_back(bus);
+    }
+    for (const size_t stop : geometry.sorted_stop_ids) {
+        if (geometry.stop_on_route[stop]) selection.stops.push_back(stop);
+    }
+    return GetSVG(geometry, [&stop_points](size_t stop) { return stop_points[stop]; }, selection, render_settings_.simplify_tolerance);
+}
+
+SphereProjector MapRenderer::GetMapProjector(const transport::RouteGeometry& geometry) const {
+    // Крайние точки набора не зависят от повторов, поэтому достаточно взять каждую остановку маршрутов один раз
+    std::vector<geo::Coordinates> route_stops_coord;
+    for (size_t stop = 0; stop < geometry.stop_on_route.size(); ++stop) {
+        if (geometry.stop_on_route[stop]) {
+            route_stops_coord.push_back(geometry.StopCoordinates(stop));
+        }
+    }
+    return { route_stops_coord.begin(), route_stops_coord.end(), render_settings_.width, render_settings_.height, render_settings_.padding };
+}
+
+svg::Document MapRenderer::GetSVG(const transport::RouteGeometry& geometry, const MapIndex& index, const MapView& view) const {
+    const double lat_margin = (view.box.max.lat - view.box.min.lat) * view.margin;
+    const double lng_margin = (view.box.max.lng - view.box.min.lng) * view.margin;
+    const geo::BoundingBox select_box = {
+        { view.box.min.lat - lat_margin, view.box.min.lng - lng_margin },
+        { view.box.max.lat + lat_margin, view.box.max.lng + lng_margin } };
+    const MapSelection selection = index.Select(geometry, select_box);
+    const geo::Coordinates corners[] = { view.box.min, view.box.max };
+    const SphereProjector sp(std::begin(corners), std::end(corners),
+        view.width.value_or(render_settings_.width), view.height.value_or(render_settings_.height), view.padding.value_or(render_settings_.padding));
+
+    // Линии обрезаются по области отбора с запасом в ширину линии, за которым их не видно, а названия
+    // маршрутов выводятся только у конечных внутри неё: длинный маршрут не переносится в изображение целиком
+    const svg::Point top_left = sp({ select_box.max.lat, select_box.min.lng });
+    const svg::Point bottom_right = sp({ select_box.min.lat, select_box.max.lng });
+    const ClipBox clip = {
+        { top_left.x - render_settings_.line_width, top_left.y - render_settings_.line_width },
+        { bottom_right.x + render_settings_.line_width, bottom_right.y + render_settings_.line_width } };
+
+    // Проецируются только остановки отобранных маршрутов и сами отобранные остановки, по мере обращения
+    return GetSVG(geometry, [&geometry, &sp](size_t stop) { return sp(geometry.StopCoordinates(stop)); }, selection,
+        view.simplify_tolerance.value_or(render_settings_.simplify_tolerance), &clip);
+}
+
+template <typename StopPoint>
+svg::Document MapRenderer::GetSVG(const transport::RouteGeometry& geometry, const StopPoint& stop_point, const MapSelection& selection,
+    double simplify_tolerance, const ClipBox* clip) const {
+    // Фигуры переносятся в документ без копирования; на маршрут приходятся линия и до двух пар надписей,
+    // на остановку — значок и пара надписей
+    svg::Document result;
+    result.Reserve(selection.buses.size() * 5 + selection.stops.size() * 3);
+    for (const size_t bus : selection.buses) {
+        if (!clip) {
+            result.Add(GetBusLine(geometry, stop_point, bus, simplify_tolerance));
+            continue;
+        }
+        for (const auto& part : ClipPolyline(GetBusPoints(geometry, stop_point, bus, simplify_tolerance), clip->min, clip->max)) {
+            result.Add(GetRouteLine(part, GetBusColor(geometry, bus)));
+        }
+    }
+    std::vector<svg::Text> labels;
+    for (const size_t bus : selection.buses) {
+        AddBusLabels(geometry, stop_point, bus, labels, clip);
+    }
+    for (auto& text : labels) result.Add(std::move(text));
+    for (const size_t stop : selection.stops) {
+        result.Add(GetStopSymbol(stop_point(stop)));
+    }
+    labels.clear();
+    for (const size_t stop : selection.stops) {
+        AddStopLabels(geometry.stops[stop]->name, stop_point(stop), labels);
+    }
+    for (auto& text : labels) result.Add(std::move(text));
+    if (render_settings_.compact_svg) {
+        result.SetLayout(svg::Layout::COMPACT);
+        result.SetStyle(GetCompactStyle());
     }
+    result.SetNumberStyle(render_settings_.number_style);
 
     return result;
 }
 
-svg::Document MapRenderer::GetSVG(const std::map<std::string_view, const transport::Bus*>& buses) const {
+svg::Document MapRenderer::GetRouteSVG(const transport::RouteGeometry& geometry, const Journey& journey) const {
+    std::vector<geo::Coordinates> journey_coords;
+    for (const auto& ride : journey.rides) {
+        for (const size_t stop : ride.stops) {
+            journey_coords.push_back(geometry.StopCoordinates(stop));
+        }
+    }
+    for (const size_t stop : journey.stops) {
+        journey_coords.push_back(geometry.StopCoordinates(stop));
+    }
+    const SphereProjector sp(journey_coords.begin(), journey_coords.end(), render_settings_.width, render_settings_.height, render_settings_.padding);
+
+    // Значки и названия остановок поездки идут, как на полной карте, по возрастанию названий
+    std::vector<size_t> stops = journey.stops;
+    std::sort(stops.begin(), stops.end(), [&geometry](size_t lhs, size_t rhs) {
+        return geometry.stop_name_ranks[lhs] < geometry.stop_name_ranks[rhs];
+    });
+    stops.erase(std::unique(stops.begin(), stops.end()), stops.end());
+
     svg::Document result;
-    std::vector<geo::Coordinates> route_stops_coord;
-    std::map<std::string_view, const transport::Stop*> all_stops;
+    std::vector<svg::Point> points;
+    for (const auto& ride : journey.rides) {
+        points.clear();
+        for (const size_t stop : ride.stops) {
+            points.push_back(sp(geometry.StopCoordinates(stop)));
+        }
+        result.Add(GetRouteLine(points, GetBusColor(geometry, ride.bus)));
+    }
+    for (const size_t stop : stops) {
+        result.Add(GetStopSymbol(sp(geometry.StopCoordinates(stop))));
+    }
+    std::vector<svg::Text> labels;
+    for (const size_t stop : stops) {
+        AddStopLabels(geometry.stops[stop]->name, sp(geometry.StopCoordinates(stop)), labels);
+    }
+    for (auto& text : labels) result.Add(std::move(text));
+    if (render_settings_.compact_svg) {
+        result.SetLayout(svg::Layout::COMPACT);
+        result.SetStyle(GetCompactStyle());
+    }
+    result.SetNumberStyle(render_settings_.number_style);
 
-    for (const auto& [bus_number, bus] : buses) {
-        if (bus->stops.empty()) continue;
-        for (const auto& stop : bus->stops) {
-            route_stops_coord.push_back(stop->coordinates);
-            all_stops[stop->name] = stop;
+    return result;
+}
+
+std::string MapRenderer::GetCompactStyle() const {
+    using namespace std::literals;
+
+    // Классы, которые слои карты задают вместо атрибутов:
+    // l — линия маршрута, u — подложка надписи, b — название маршрута, t — название остановки,
+    // k — чёрный текст, s — значок остановки
+    format::Buffer style(render_settings_.number_style);
+    style << ".l{fill:none;stroke-width:"sv << render_settings_.line_width << ";stroke-linecap:round;stroke-linejoin:round}"sv;
+    style << ".u{fill:"sv;
+    std::visit(svg::ColorPrinter{ style }, render_settings_.underlayer_color);
+    style << ";stroke:"sv;
+    std::visit(svg::ColorPrinter{ style }, render_settings_.underlayer_color);
+    style << ";stroke-width:"sv << render_settings_.underlayer_width << ";stroke-linecap:round;stroke-linejoin:round}"sv;
+    style << ".b{font-family:Verdana;font-weight:bold}.t{font-family:Verdana}.k{fill:black}.s{fill:white}"sv;
+    return std::string(style.View());
+}
+
+std::string MapRenderer::GetSVGText(const transport::RouteGeometry& geometry, size_t threads_count) const {
+    return RenderFragments(geometry, threads_count).svg;
+}
+
+MapFragments MapRenderer::RenderFragments(const transport::RouteGeometry& geometry, size_t threads_count) const {
+    const std::vector<svg::Point> stop_points = ProjectStops(geometry, GetMapProjector(geometry));
+    const auto stop_point = [&stop_points](size_t stop) {
+        return stop_points[stop];
+    };
+
+    // Фрагменты в порядке вывода: линии маршрутов, названия маршрутов, значки и названия остановок.
+    // Ключ фрагмента — хеш настроек, его вида и всего, от чего зависит текст, включая точки после проекции,
+    // поэтому правка маршрута или смена проекции меняет ключи только затронутых фрагментов
+    enum class Kind : char { LINE = 'l', BUS_LABELS = 'b', STOP_SYMBOL = 's', STOP_LABELS = 't' };
+    struct Fragment {
+        Kind kind;
+        size_t item;
+        uint64_t key;
+    };
+    std::vector<Fragment> fragments;
+    std::string key;
+    for (const Kind kind : { Kind::LINE, Kind::BUS_LABELS }) {
+        for (size_t bus = 0; bus < geometry.BusCount(); ++bus) {
+            if (geometry.BusStopsCount(bus) == 0) continue;
+            key.assign(1, static_cast<char>(kind));
+            AppendKeyBytes(key, GetBusColor(geometry, bus));
+            key.push_back(static_cast<char>(geometry.bus_is_circle[bus]));
+            if (kind == Kind::LINE) {
+                for (const size_t* stop = geometry.BusStopsBegin(bus); stop != geometry.BusStopsEnd(bus); ++stop) {
+                    AppendKeyBytes(key, stop_points[*stop]);
+                }
+            }
+            else {
+                AppendKeyBytes(key, stop_points[*geometry.BusStopsBegin(bus)]);
+                AppendKeyBytes(key, stop_points[*(geometry.BusStopsEnd(bus) - 1)]);
+                key += geometry.buses[bus]->number;
+            }
+            fragments.push_back({ kind, bus, HashBytes(key, settings_hash_) });
+        }
+    }
+    for (const Kind kind : { Kind::STOP_SYMBOL, Kind::STOP_LABELS }) {
+        for (const size_t stop : geometry.sorted_stop_ids) {
+            if (!geometry.stop_on_route[stop]) continue;
+            key.assign(1, static_cast<char>(kind));
+            AppendKeyBytes(key, stop_points[stop]);
+            if (kind == Kind::STOP_LABELS) {
+                key += geometry.stops[stop]->name;
+            }
+            fragments.push_back({ kind, stop, HashBytes(key, settings_hash_) });
         }
     }
-    SphereProjector sp(route_stops_coord.begin(), route_stops_coord.end(), render_settings_.width, render_settings_.height, render_settings_.padding);
 
-    for (const auto& line : GetRouteLines(buses, sp)) result.Add(line);
-    for (const auto& text : GetBusLabel(buses, sp)) result.Add(text);
-    for (const auto& circle : GetStopsSymbols(all_stops, sp)) result.Add(circle);
-    for (const auto& text : GetStopsLabels(all_stops, sp)) result.Add(text);
+    svg::Document frame;
+    if (render_settings_.compact_svg) {
+        frame.SetLayout(svg::Layout::COMPACT);
+        frame.SetStyle(GetCompactStyle());
+    }
+    const svg::Layout layout = render_settings_.compact_svg ? svg::Layout::COMPACT : svg::Layout::INDENTED;
+    const auto render_fragment = [&](const Fragment& fragment) {
+        format::Buffer out(render_settings_.number_style);
+        // Тот же контекст и стиль чисел, что и у фигур в svg::Document::Render
+        const svg::RenderContext context(out, 2, 2, layout);
+        std::vector<svg::Text> labels;
+        switch (fragment.kind) {
+        case Kind::LINE:
+            GetBusLine(geometry, stop_point, fragment.item, render_settings_.simplify_tolerance).Render(context);
+            break;
+        case Kind::BUS_LABELS:
+            AddBusLabels(geometry, stop_point, fragment.item, labels);
+            break;
+        case Kind::STOP_SYMBOL:
+            GetStopSymbol(stop_points[fragment.item]).Render(context);
+            break;
+        case Kind::STOP_LABELS:
+            AddStopLabels(geometry.stops[fragment.item]->name, stop_points[fragment.item], labels);
+            break;
+        }
+        for (const auto& label : labels) {
+            label.Render(context);
+        }
+        return std::string(out.View());
+    };
 
+    std::lock_guard guard(fragment_cache_->mutex);
+    const MapFragments& cached = fragment_cache_->map;
+    // Тексты из кэша остаются частями cached.svg; несколько фрагментов с одинаковым ключом
+    // (например, остановки в одной точке) читают один и тот же текст
+    std::vector<std::string_view> texts(fragments.size());
+    std::vector<std::string> rendered(fragments.size());
+    std::vector<size_t> missing;
+    for (size_t i = 0; i < fragments.size(); ++i) {
+        if (const auto it = fragment_cache_->index.find(fragments[i].key); it != fragment_cache_->index.end()) {
+            texts[i] = std::string_view(cached.svg).substr(cached.offsets[it->second], cached.offsets[it->second + 1] - cached.offsets[it->second]);
+        }
+        else {
+            missing.push_back(i);
+        }
+    }
+
+    // Недостающие фрагменты рисуются кусками в отдельные строки, порядок вывода от этого не зависит
+    constexpr size_t min_chunk_size = 256;
+    if (threads_count > 1 && missing.size() > min_chunk_size) {
+        const size_t chunk_size = std::max(min_chunk_size, (missing.size() + 4 * threads_count - 1) / (4 * threads_count));
+        std::vector<std::function<void()>> tasks;
+        for (size_t first = 0; first < missing.size(); first += chunk_size) {
+            tasks.push_back([&, first, chunk_size] {
+                for (size_t i = first; i < std::min(first + chunk_size, missing.size()); ++i) {
+                    rendered[missing[i]] = render_fragment(fragments[missing[i]]);
+                }
+            });
+        }
+        ThreadPool pool(threads_count);
+        pool.Run(std::move(tasks));
+    }
+    else {
+        for (const size_t i : missing) {
+            rendered[i] = render_fragment(fragments[i]);
+        }
+    }
+    for (const size_t i : missing) {
+        texts[i] = rendered[i];
+    }
+
+    MapFragments result;
+    result.keys.reserve(fragments.size());
+    result.offsets.reserve(fragments.size() + 1);
+    format::Buffer svg_text;
+    frame.RenderBegin(svg_text);
+    for (size_t i = 0; i < fragments.size(); ++i) {
+        result.keys.push_back(fragments[i].key);
+        result.offsets.push_back(svg_text.View().size());
+        svg_text << texts[i];
+    }
+    result.offsets.push_back(svg_text.View().size());
+    frame.RenderEnd(svg_text);
+    result.svg = std::string(svg_text.View());
+
+    // В кэше остаются только фрагменты этой карты
+    SetCache(*fragment_cache_, result);
     return result;
 }
 
+void MapRenderer::SetCachedFragments(MapFragments fragments) {
+    // Разметка из повреждённой базы не используется: карта тогда просто рисуется заново
+    bool is_valid = fragments.offsets.size() == fragments.keys.size() + 1 && fragments.offsets.back() <= fragments.svg.size();
+    for (size_t i = 1; is_valid && i < fragments.offsets.size(); ++i) {
+        is_valid = fragments.offsets[i - 1] <= fragments.offsets[i];
+    }
+    if (!is_valid) {
+        fragments = {};
+    }
+    std::lock_guard guard(fragment_cache_->mutex);
+    SetCache(*fragment_cache_, std::move(fragments));
+}
+
+void MapRenderer::SetCache(FragmentCache& cache, MapFragments fragments) {
+    cache.map = std::move(fragments);
+    cache.index.clear();
+    for (size_t i = 0; i < cache.map.keys.size(); ++i) {
+        cache.index.emplace(cache.map.keys[i], i);
+    }
+}
+
+uint64_t MapRenderer::HashSettings(const RenderSettings& settings) {
+    // Размеры тайлов на полную карту не влияют и в хеш не входят
+    std::string bytes;
+    for (const double value : { settings.width, settings.height, settings.padding, settings.stop_radius, settings.line_width,
+        settings.bus_label_offset.x, settings.bus_label_offset.y, settings.stop_label_offset.x, settings.stop_label_offset.y,
+        settings.underlayer_width, settings.simplify_tolerance }) {
+        AppendKeyBytes(bytes, value);
+    }
+    AppendKeyBytes(bytes, settings.bus_label_font_size);
+    AppendKeyBytes(bytes, settings.stop_label_font_size);
+    bytes.push_back(static_cast<char>(settings.compact_svg));
+    bytes.push_back(static_cast<char>(settings.number_style.format));
+    AppendKeyBytes(bytes, settings.number_style.precision);
+    format::Buffer colors;
+    std::visit(svg::ColorPrinter{ colors }, settings.underlayer_color);
+    for (const auto& color : settings.color_palette) {
+        colors << ';';
+        std::visit(svg::ColorPrinter{ colors }, color);
+    }
+    bytes += colors.View();
+    return HashBytes(bytes);
+}
+
 const RenderSettings MapRenderer::GetRenderSettings() const {
     return render_settings_;
 }
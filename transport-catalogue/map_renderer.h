@@ -1,11 +1,19 @@
 #pragma once
 
 #include "svg.h"
+#include "format.h"
 #include "geo.h"
 #include "json.h"
 #include "domain.h"
+#include "map_index.h"
+#include "thread_pool.h"
 
 #include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 
 namespace renderer {
 
@@ -94,6 +102,55 @@ struct RenderSettings {
     svg::Color underlayer_color = { svg::NoneColor };
     double underlayer_width = 0.0;
     std::vector<svg::Color> color_palette {};
+    // Компактный SVG: общие свойства фигур задаются классами в <style>, элементы выводятся без отступов и переводов строк
+    bool compact_svg = false;
+    // Вывод чисел в SVG; по умолчанию он совпадает с выводом через std::ostream
+    format::DoubleStyle number_style;
+    // Допуск упрощения линий маршрутов в пикселях после проекции; 0 — линии проходят через все остановки
+    double simplify_tolerance = 0.0;
+    // Число уровней пирамиды тайлов, которую make_base сохраняет в базе; 0 — без тайлов
+    int tile_levels = 0;
+    // Сторона тайла в пикселях
+    int tile_size = 256;
+};
+
+// На уровне zoom пирамиды 4^zoom тайлов, поэтому число уровней ограничено
+inline constexpr int MAX_TILE_LEVELS = 10;
+// Предел суммарного размера различных тайлов: база должна оставаться много меньше 2 ГБ, предела protobuf
+inline constexpr size_t MAX_TILE_BYTES = size_t{ 512 } << 20;
+
+// Часть карты в прямоугольнике box. Если размеры изображения и отступ не заданы, берутся из настроек
+struct MapView {
+    geo::BoundingBox box;
+    std::optional<double> width;
+    std::optional<double> height;
+    std::optional<double> padding;
+    // На сколько долей размера box расширяется отбор объектов, чтобы подписи и значки
+    // у края не обрезались на стыке соседних изображений
+    double margin = 0.0;
+    // Допуск упрощения линий маршрутов в пикселях, если он отличается от заданного в настройках
+    std::optional<double> simplify_tolerance;
+};
+
+// Найденная поездка для карты маршрута. Номера остановок и маршрутов — индексы RouteGeometry
+struct Journey {
+    // Проезд на маршруте bus через остановки stops по порядку
+    struct Ride {
+        size_t bus = 0;
+        std::vector<size_t> stops;
+    };
+
+    std::vector<Ride> rides;
+    // Остановки отправления, ожидания и прибытия
+    std::vector<size_t> stops;
+};
+
+// Карта, собранная из фрагментов: по одному на линию маршрута, названия маршрута, значок и название остановки.
+// Фрагмент i — это svg[offsets[i], offsets[i + 1]), keys[i] — его ключ
+struct MapFragments {
+    std::string svg;
+    std::vector<uint64_t> keys;
+    std::vector<size_t> offsets;
 };
 
 class MapRenderer {
@@ -104,17 +161,78 @@ public:
         : render_settings_(render_settings)
     {}
 
-    std::vector<svg::Polyline> GetRouteLines(const std::map<std::string_view, const transport::Bus*>& buses, const SphereProjector& sp) const;
-    std::vector<svg::Text> GetBusLabel(const std::map<std::string_view, const transport::Bus*>& buses, const SphereProjector& sp) const;
-    std::vector<svg::Circle> GetStopsSymbols(const std::map<std::string_view, const transport::Stop*>& stops, const SphereProjector& sp) const;
-    std::vector<svg::Text> GetStopsLabels(const std::map<std::string_view, const transport::Stop*>& stops, const SphereProjector& sp) const;
-
-    svg::Document GetSVG(const std::map<std::string_view, const transport::Bus*>& buses) const;
+    // Точки остановок маршрутов на изображении по индексам RouteGeometry. Слои карты берут
+    // координаты отсюда, поэтому каждая остановка проецируется один раз
+    std::vector<svg::Point> ProjectStops(const transport::RouteGeometry& geometry, const SphereProjector& sp) const;
+
+    svg::Document GetSVG(const transport::RouteGeometry& geometry) const;
+    // Рисует маршруты и остановки, которые index отбирает в view.box, вписывая в изображение сам прямоугольник
+    svg::Document GetSVG(const transport::RouteGeometry& geometry, const MapIndex& index, const MapView& view) const;
+    // Рисует только поездку: проезды цветом своего маршрута, остановки ожидания значками с названиями.
+    // Изображение вписывается в прямоугольник остановок поездки
+    svg::Document GetRouteSVG(const transport::RouteGeometry& geometry, const Journey& journey) const;
+    // Рисует карту и возвращает готовый SVG-текст, который сохраняется в базе. Карта собирается из текстов
+    // отдельных маршрутов и остановок; тексты, не изменившиеся с прошлого вызова, берутся из кэша.
+    // При threads_count > 1 недостающие тексты рисуются параллельно; результат от этого не зависит
+    std::string GetSVGText(const transport::RouteGeometry& geometry, size_t threads_count = 1) const;
+    // То же, что GetSVGText, но вместе с разметкой на фрагменты, которую база хранит рядом с картой
+    MapFragments RenderFragments(const transport::RouteGeometry& geometry, size_t threads_count = 1) const;
+    // Заполняет кэш фрагментами карты из базы, чтобы update_base перерисовал только изменившееся.
+    // Несогласованная разметка отбрасывается
+    void SetCachedFragments(MapFragments fragments);
 
     const RenderSettings GetRenderSettings() const;
 
 private:
+    // Карта, выведенная последним вызовом GetSVGText, и номера её фрагментов по ключам.
+    // Копии отрисовщика разделяют кэш, поэтому следующая версия снимка перерисовывает только изменившееся
+    struct FragmentCache {
+        std::mutex mutex;
+        MapFragments map;
+        std::unordered_map<uint64_t, size_t> index;
+    };
+
     const RenderSettings render_settings_;
+    // Входит в ключи фрагментов: при других настройках кэш не используется
+    const uint64_t settings_hash_ = HashSettings(render_settings_);
+    std::shared_ptr<FragmentCache> fragment_cache_ = std::make_shared<FragmentCache>();
+
+    static uint64_t HashSettings(const RenderSettings& settings);
+    static void SetCache(FragmentCache& cache, MapFragments fragments);
+
+    // Прямоугольник изображения с углами min и max
+    struct ClipBox {
+        svg::Point min;
+        svg::Point max;
+    };
+
+    // Проекция, в которую вписываются все остановки маршрутов
+    SphereProjector GetMapProjector(const transport::RouteGeometry& geometry) const;
+    // Слои карты из маршрутов и остановок selection. stop_point(stop) даёт точку остановки на изображении,
+    // поэтому проецируются только остановки, которые действительно выводятся. Цвета маршрутов те же, что и на полной карте
+    // При заданном clip линии маршрутов обрезаются по этому прямоугольнику изображения
+    template <typename StopPoint>
+    svg::Document GetSVG(const transport::RouteGeometry& geometry, const StopPoint& stop_point, const MapSelection& selection,
+        double simplify_tolerance, const ClipBox* clip = nullptr) const;
+    // Точки ломаной маршрута bus после упрощения
+    template <typename StopPoint>
+    std::vector<svg::Point> GetBusPoints(const transport::RouteGeometry& geometry, const StopPoint& stop_point, size_t bus,
+        double simplify_tolerance) const;
+    template <typename StopPoint>
+    svg::Polyline GetBusLine(const transport::RouteGeometry& geometry, const StopPoint& stop_point, size_t bus,
+        double simplify_tolerance) const;
+    // При заданном clip названия у конечных вне этого прямоугольника не выводятся
+    template <typename StopPoint>
+    void AddBusLabels(const transport::RouteGeometry& geometry, const StopPoint& stop_point, size_t bus,
+        std::vector<svg::Text>& result, const ClipBox* clip = nullptr) const;
+    svg::Circle GetStopSymbol(svg::Point point) const;
+    void AddStopLabels(const std::string& name, svg::Point point, std::vector<svg::Text>& result) const;
+    // Ломаная маршрута цветом палитры color_num
+    svg::Polyline GetRouteLine(const std::vector<svg::Point>& points, size_t color_num) const;
+    // Номер цвета маршрута bus на полной карте
+    size_t GetBusColor(const transport::RouteGeometry& geometry, size_t bus) const;
+    // Таблица стилей для режима compact_svg
+    std::string GetCompactStyle() const;
 };
 
 }
\ No newline at end of file
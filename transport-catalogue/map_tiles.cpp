@@ -0,0 +1,129 @@
+#include "map_tiles.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+
+namespace renderer {
+
+using namespace std::literals;
+
+namespace {
+
+// Самый мелкий уровень должен вмещать и сеть из одной остановки
+constexpr double MIN_TILE_DEGREES = 1e-4;
+// Отклонения линии меньше пикселя на тайле неразличимы
+constexpr double TILE_SIMPLIFY_TOLERANCE = 1.0;
+// Подписи и значки остановок у края тайла дорисовываются на соседнем
+constexpr double TILE_MARGIN = 0.25;
+
+}  // namespace
+
+TilePyramid::TilePyramid(std::vector<std::string> svgs, std::vector<std::vector<uint32_t>> levels)
+    : svgs_(std::move(svgs))
+    , levels_(std::move(levels)) {
+}
+
+TilePyramid TilePyramid::Build(const MapRenderer& renderer, const transport::RouteGeometry& geometry, const MapIndex& index, size_t threads_count) {
+    const RenderSettings& settings = renderer.GetRenderSettings();
+    if (settings.tile_levels <= 0) {
+        return {};
+    }
+
+    const geo::BoundingBox& bounds = index.GetBounds();
+    const double side = std::max({ bounds.max.lat - bounds.min.lat, bounds.max.lng - bounds.min.lng, MIN_TILE_DEGREES });
+
+    // Тайлы всех уровней рисуются независимо, а повторы отбрасываются сразу после отрисовки: в памяти
+    // остаются только различные тексты. Номер текста пока зависит от порядка работы потоков
+    std::mutex mutex;
+    std::deque<std::string> drawn_svgs;
+    std::unordered_map<std::string_view, uint32_t> drawn_ids;
+    size_t drawn_bytes = 0;
+    std::vector<std::vector<uint32_t>> drawn_levels(settings.tile_levels);
+    std::vector<std::function<void()>> tasks;
+    for (int zoom = 0; zoom < settings.tile_levels; ++zoom) {
+        const size_t count = size_t{ 1 } << zoom;
+        const double step = side / static_cast<double>(count);
+        drawn_levels[zoom].resize(count * count);
+        for (size_t y = 0; y < count; ++y) {
+            tasks.push_back([&, zoom, count, step, y] {
+                format::Buffer svg_text;
+                for (size_t x = 0; x < count; ++x) {
+                    MapView view;
+                    view.box.min = { bounds.max.lat - static_cast<double>(y + 1) * step, bounds.min.lng + static_cast<double>(x) * step };
+                    view.box.max = { bounds.max.lat - static_cast<double>(y) * step, bounds.min.lng + static_cast<double>(x + 1) * step };
+                    view.width = view.height = settings.tile_size;
+                    view.padding = 0.0;
+                    view.margin = TILE_MARGIN;
+                    view.simplify_tolerance = std::max(settings.simplify_tolerance, TILE_SIMPLIFY_TOLERANCE);
+                    svg_text.Clear();
+                    renderer.GetSVG(geometry, index, view).Render(svg_text);
+
+                    std::lock_guard lock(mutex);
+                    auto it = drawn_ids.find(svg_text.View());
+                    if (it == drawn_ids.end()) {
+                        drawn_bytes += svg_text.View().size();
+                        if (drawn_bytes > MAX_TILE_BYTES) {
+                            throw std::runtime_error("Map tiles exceed "s + std::to_string(MAX_TILE_BYTES) + " bytes, reduce tile_levels"s);
+                        }
+                        // Ключи смотрят в тексты очереди, которые при добавлении новых не перемещаются
+                        drawn_svgs.emplace_back(svg_text.View());
+                        it = drawn_ids.emplace(drawn_svgs.back(), static_cast<uint32_t>(drawn_svgs.size() - 1)).first;
+                    }
+                    drawn_levels[zoom][y * count + x] = it->second;
+                }
+            });
+        }
+    }
+    ThreadPool pool(std::max<size_t>(1, threads_count));
+    pool.Run(std::move(tasks));
+
+    // Тексты нумеруются заново в порядке первого появления по уровням и строкам,
+    // чтобы база не зависела от числа потоков
+    constexpr uint32_t NO_ID = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> final_ids(drawn_svgs.size(), NO_ID);
+    std::vector<std::string> svgs;
+    svgs.reserve(drawn_svgs.size());
+    for (auto& level : drawn_levels) {
+        for (uint32_t& id : level) {
+            if (final_ids[id] == NO_ID) {
+                final_ids[id] = static_cast<uint32_t>(svgs.size());
+                svgs.push_back(std::move(drawn_svgs[id]));
+            }
+            id = final_ids[id];
+        }
+    }
+    return { std::move(svgs), std::move(drawn_levels) };
+}
+
+const std::string* TilePyramid::Find(int zoom, int x, int y) const {
+    if (zoom < 0 || static_cast<size_t>(zoom) >= levels_.size() || x < 0 || y < 0) {
+        return nullptr;
+    }
+    const size_t count = size_t{ 1 } << zoom;
+    if (static_cast<size_t>(x) >= count || static_cast<size_t>(y) >= count) {
+        return nullptr;
+    }
+    const auto& level = levels_[zoom];
+    const size_t position = static_cast<size_t>(y) * count + static_cast<size_t>(x);
+    if (position >= level.size() || level[position] >= svgs_.size()) {
+        return nullptr;
+    }
+    return &svgs_[level[position]];
+}
+
+const std::vector<std::string>& TilePyramid::GetSvgs() const {
+    return svgs_;
+}
+
+const std::vector<std::vector<uint32_t>>& TilePyramid::GetLevels() const {
+    return levels_;
+}
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "map_index.h"
+#include "map_renderer.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace renderer {
+
+/*
+    * Пирамида тайлов карты, нарисованная при сохранении базы.
+    * Уровень zoom покрывает квадрат над прямоугольником всех остановок сеткой 2^zoom × 2^zoom,
+    * тайл (x, y) отсчитывается от северо-западного угла. Каждый тайл рисуется в своей проекции
+    * размером tile_size, поэтому на мелких уровнях ломаные упрощаются сильнее, а на крупных от них
+    * остаются только перегоны у тайла.
+    * Одинаковые тайлы (прежде всего пустые) хранятся один раз: уровень — это номера SVG-текстов
+    */
+class TilePyramid {
+public:
+    TilePyramid() = default;
+    // levels[zoom] — номера текстов из svgs по строкам сетки уровня
+    TilePyramid(std::vector<std::string> svgs, std::vector<std::vector<uint32_t>> levels);
+
+    // Рисует render_settings.tile_levels уровней на threads_count потоках. Если различные тайлы
+    // занимают больше MAX_TILE_BYTES, бросает std::runtime_error вместо того, чтобы раздувать базу
+    static TilePyramid Build(const MapRenderer& renderer, const transport::RouteGeometry& geometry, const MapIndex& index, size_t threads_count);
+
+    // SVG-текст тайла или nullptr, если такого тайла нет
+    const std::string* Find(int zoom, int x, int y) const;
+
+    const std::vector<std::string>& GetSvgs() const;
+    const std::vector<std::vector<uint32_t>>& GetLevels() const;
+
+private:
+    std::vector<std::string> svgs_;
+    std::vector<std::vector<uint32_t>> levels_;
+};
+
+}
@@ -1,5 +1,8 @@
 #include "request_handler.h"
 
+#include <algorithm>
+#include <iterator>
+
 std::optional<transport::BusStat> RequestHandler::GetBusStat(const std::string_view bus_number) const {
     return catalogue_.GetBusStat(bus_number);
 }
@@ -24,6 +27,87 @@ const graph::DirectedWeightedGraph<double>& RequestHandler::GetRouterGraph() con
     return router_.GetGraph();
 }
 
+const transport::Stop* RequestHandler::FindStopById(size_t stop_id) const {
+    return catalogue_.GetStop(stop_id);
+}
+
+const transport::Bus* RequestHandler::FindBusById(size_t bus_id) const {
+    const auto& buses = catalogue_.GetRouteGeometry().buses;
+    return bus_id < buses.size() ? buses[bus_id] : nullptr;
+}
+
+std::optional<size_t> RequestHandler::GetStopId(std::string_view stop_name) const {
+    const transport::Stop* stop = catalogue_.FindStop(stop_name);
+    return stop ? std::optional(stop->id) : std::nullopt;
+}
+
+std::optional<size_t> RequestHandler::GetBusId(std::string_view bus_number) const {
+    const auto& buses = catalogue_.GetRouteGeometry().buses;
+    const auto it = std::lower_bound(buses.begin(), buses.end(), bus_number, [](const transport::Bus* bus, std::string_view number) {
+        return bus->number < number;
+    });
+    if (it == buses.end() || (*it)->number != bus_number) {
+        return std::nullopt;
+    }
+    return static_cast<size_t>(it - buses.begin());
+}
+
 svg::Document RequestHandler::RenderMap() const {
-    return renderer_.GetSVG(catalogue_.GetSortedAllBuses());
+    return renderer_.GetSVG(catalogue_.GetRouteGeometry());
+}
+
+std::string_view RequestHandler::GetMapSvg() const {
+    return map_svg_;
+}
+
+std::string_view RequestHandler::GetMapSvgGzip() const {
+    return map_svg_gzip_;
+}
+
+svg::Document RequestHandler::RenderMap(const renderer::MapView& view) const {
+    return renderer_.GetSVG(catalogue_.GetRouteGeometry(), map_index_, view);
+}
+
+std::optional<svg::Document> RequestHandler::RenderRouteMap(std::string_view stop_from, std::string_view stop_to) const {
+    const auto routing = router_.FindRoute(stop_from, stop_to);
+    if (!routing) {
+        return std::nullopt;
+    }
+    const auto& geometry = catalogue_.GetRouteGeometry();
+    renderer::Journey journey;
+    journey.stops.push_back(*GetStopId(stop_from));
+    // Рёбра поездки чередуются: ожидание на остановке, затем проезд от неё на span_count перегонов.
+    // Проезд заканчивается там, где начинается следующее ожидание, или в конечной остановке
+    const auto& edges = routing->edges;
+    for (size_t i = 0; i < edges.size(); ++i) {
+        const auto& edge = router_.GetGraph().GetEdge(edges[i]);
+        if (edge.quality == 0) {
+            journey.stops.push_back(*GetStopId(edge.name));
+            continue;
+        }
+        const size_t from = journey.stops.back();
+        const size_t to = i + 1 < edges.size() ? *GetStopId(router_.GetGraph().GetEdge(edges[i + 1]).name) : *GetStopId(stop_to);
+        const size_t bus = *GetBusId(edge.name);
+        const size_t span = edge.quality;
+        const size_t* stops = geometry.BusStopsBegin(bus);
+        const size_t stops_count = geometry.BusStopsCount(bus);
+        renderer::Journey::Ride ride{ bus, {} };
+        for (size_t start = 0; start < stops_count && ride.stops.empty(); ++start) {
+            if (stops[start] != from) continue;
+            if (start + span < stops_count && stops[start + span] == to) {
+                ride.stops.assign(stops + start, stops + start + span + 1);
+            }
+            // Некольцевой маршрут проходит те же остановки в обратном порядке
+            else if (!geometry.bus_is_circle[bus] && start >= span && stops[start - span] == to) {
+                ride.stops.assign(std::make_reverse_iterator(stops + start + 1), std::make_reverse_iterator(stops + start - span));
+            }
+        }
+        journey.rides.push_back(std::move(ride));
+    }
+    journey.stops.push_back(*GetStopId(stop_to));
+    return renderer_.GetRouteSVG(geometry, journey);
+}
+
+const std::string* RequestHandler::GetTile(int zoom, int x, int y) const {
+    return tiles_.Find(zoom, x, y);
 }
\ No newline at end of file
@@ -4,16 +4,30 @@
 #include "transport_catalogue.h"
 #include "map_renderer.h"
 #include "transport_router.h"
+#include "snapshot.h"
 
 #include <sstream>
 #include <optional>
 
+// Все методы константные. Обработчик, построенный над transport::Snapshot,
+// можно вызывать из нескольких потоков одновременно
 class RequestHandler {
 public:
-    RequestHandler(const transport::Catalogue& catalogue, const renderer::MapRenderer& renderer, const transport::Router& router)
+    RequestHandler(const transport::Catalogue& catalogue, const renderer::MapRenderer& renderer, const transport::Router& router,
+        std::string_view map_svg, std::string_view map_svg_gzip, const renderer::MapIndex& map_index, const renderer::TilePyramid& tiles)
         : catalogue_(catalogue)
         , renderer_(renderer)
         , router_(router)
+        , map_svg_(map_svg)
+        , map_svg_gzip_(map_svg_gzip)
+        , map_index_(map_index)
+        , tiles_(tiles)
+    {
+    }
+
+    explicit RequestHandler(const transport::Snapshot& snapshot)
+        : RequestHandler(snapshot.GetCatalogue(), snapshot.GetRenderer(), snapshot.GetRouter(), snapshot.GetMapSvg(), snapshot.GetMapSvgGzip(),
+            snapshot.GetMapIndex(), snapshot.GetTiles())
     {
     }
 
@@ -23,11 +37,32 @@ public:
     bool IsStopName(const std::string_view stop_name) const;
     const std::optional<graph::Router<double>::RouteInfo> GetOptimalRoute(const std::string_view stop_from, const std::string_view stop_to) const;
     const graph::DirectedWeightedGraph<double>& GetRouterGraph() const;
+
+    // Номер остановки — Stop::id, номер маршрута — его позиция в порядке возрастания номеров.
+    // Оба совпадают с позицией в списках сохранённой базы. Для неизвестного номера — nullptr
+    const transport::Stop* FindStopById(size_t stop_id) const;
+    const transport::Bus* FindBusById(size_t bus_id) const;
+    std::optional<size_t> GetStopId(std::string_view stop_name) const;
+    std::optional<size_t> GetBusId(std::string_view bus_number) const;
     
     svg::Document RenderMap() const;
+    // Карта, нарисованная заранее; в отличие от RenderMap, ничего не вычисляет
+    std::string_view GetMapSvg() const;
+    // Та же карта, сжатая gzip
+    std::string_view GetMapSvgGzip() const;
+    // Рисует только то, что видно в прямоугольнике view.box
+    svg::Document RenderMap(const renderer::MapView& view) const;
+    // Карта оптимального маршрута между остановками; nullopt, если маршрута нет
+    std::optional<svg::Document> RenderRouteMap(std::string_view stop_from, std::string_view stop_to) const;
+    // Тайл из пирамиды, сохранённой в базе; nullptr, если такого тайла нет
+    const std::string* GetTile(int zoom, int x, int y) const;
 
 private:
     const transport::Catalogue& catalogue_;
     const renderer::MapRenderer& renderer_;
     const transport::Router& router_;
+    std::string_view map_svg_;
+    std::string_view map_svg_gzip_;
+    const renderer::MapIndex& map_index_;
+    const renderer::TilePyramid& tiles_;
 };
\ No newline at end of file
@@ -1,5 +1,8 @@
 #include "serialization.h"
+#include "gzip_stream.h"
+#include <algorithm>
 #include <fstream>
+#include <thread>
 
 namespace serialization {
     void Serialize(const transport::Catalogue& db, const renderer::MapRenderer& renderer, const transport::Router& router, std::ostream& out) {
@@ -9,22 +12,51 @@ namespace serialization {
         SerializeBuses(db, proto_db);
         SerializeRenderSettings(renderer, proto_db);
         SerializeRouter(router, proto_db);
-        proto_db.SerializeToOstream(&out);
+        SerializeMap(db, renderer, proto_db);
+        SerializeTiles(db, renderer, proto_db);
+        // Запись не удаётся при ошибке потока или если база больше 2 ГБ — предела protobuf
+        if (!proto_db.SerializeToOstream(&out)) {
+            throw std::runtime_error("Error serializing base");
+        }
     }
 
     std::tuple<transport::Catalogue, renderer::MapRenderer, transport::Router, graph::DirectedWeightedGraph<double>, std::map<std::string, graph::VertexId>> Deserialize(std::istream& input) {
-        proto_transport::TransportCatalogue proto_db;
-        proto_db.ParseFromIstream(&input);
+        return Deserialize(ParseBase(input));
+    }
+
+    std::tuple<transport::Catalogue, renderer::MapRenderer, transport::Router, graph::DirectedWeightedGraph<double>, std::map<std::string, graph::VertexId>> Deserialize(const proto_transport::TransportCatalogue& proto_db) {
         transport::Catalogue db;
         DeserializeStops(db, proto_db);
         DeserializeStopDistances(db, proto_db);
         DeserializeBuses(db, proto_db);
+        db.Freeze();
         renderer::RenderSettings render_settings;
         renderer::MapRenderer renderer = DeserializeRenderSettings(render_settings, proto_db);
+        if (proto_db.map_fragment_keys_size() > 0) {
+            renderer.SetCachedFragments({ proto_db.map_svg(),
+                { proto_db.map_fragment_keys().begin(), proto_db.map_fragment_keys().end() },
+                { proto_db.map_fragment_offsets().begin(), proto_db.map_fragment_offsets().end() } });
+        }
         transport::Router router = DeserializeRouterSettings(proto_db);
         return { std::move(db), std::move(renderer), std::move(router), DeserializeGraph(proto_db), DeserializeStopIds(proto_db) };
     }
 
+    std::shared_ptr<const transport::Snapshot> DeserializeSnapshot(std::istream& input, uint64_t version) {
+        proto_transport::TransportCatalogue proto_db = ParseBase(input);
+        auto [catalogue, renderer, router, graph, stop_ids] = Deserialize(proto_db);
+        // В базах, сохранённых до появления map_svg и map_svg_gzip, их нет: карту нарисует и сожмёт Snapshot
+        return std::make_shared<const transport::Snapshot>(std::move(catalogue), std::move(renderer), std::move(router), graph, stop_ids,
+            std::move(*proto_db.mutable_map_svg()), DeserializeTiles(proto_db), version, std::move(*proto_db.mutable_map_svg_gzip()));
+    }
+
+    proto_transport::TransportCatalogue ParseBase(std::istream& input) {
+        proto_transport::TransportCatalogue proto_db;
+        if (!proto_db.ParseFromIstream(&input)) {
+            throw std::runtime_error("Error deserialized base");
+        }
+        return proto_db;
+    }
+
     void SerializeStops(const transport::Catalogue& db, proto_transport::TransportCatalogue& proto_db) {
         const auto all_stops = db.GetSortedAllStops();
         for (const auto& stop : all_stops) {
@@ -42,8 +74,8 @@ namespace serialization {
     void SerializeStopDistances(const transport::Catalogue& db, proto_transport::TransportCatalogue& proto_db) {
         for (const auto& [stop_pair, distance] : db.GetStopDistances()) {
             proto_transport::StopDistanses proto_stop_distances;
-            proto_stop_distances.set_from(std::move(stop_pair.first->name));
-            proto_stop_distances.set_to(std::move(stop_pair.second->name));
+            proto_stop_distances.set_from(db.GetStop(stop_pair.first)->name);
+            proto_stop_distances.set_to(db.GetStop(stop_pair.second)->name);
             proto_stop_distances.set_distance(distance);
             *proto_db.add_stop_distances() = std::move(proto_stop_distances);
         }
@@ -79,9 +111,43 @@ namespace serialization {
         for (const auto& color : render_settings.color_palette) {
             *proto_render_settings.add_color_palette() = SerializeColor(color);
         }
+        proto_render_settings.set_tile_levels(render_settings.tile_levels);
+        proto_render_settings.set_tile_size(render_settings.tile_size);
+        proto_render_settings.set_simplify_tolerance(render_settings.simplify_tolerance);
+        proto_render_settings.set_compact_svg(render_settings.compact_svg);
+        proto_render_settings.set_number_format(static_cast<int32_t>(render_settings.number_style.format));
+        proto_render_settings.set_number_precision(render_settings.number_style.precision);
         *proto_db.mutable_render_settings() = std::move(proto_render_settings);
     }
 
+    void SerializeMap(const transport::Catalogue& db, const renderer::MapRenderer& renderer, proto_transport::TransportCatalogue& proto_db) {
+        renderer::MapFragments map = renderer.RenderFragments(db.GetRouteGeometry(), std::max(1u, std::thread::hardware_concurrency()));
+        for (const uint64_t key : map.keys) {
+            proto_db.add_map_fragment_keys(key);
+        }
+        for (const size_t offset : map.offsets) {
+            proto_db.add_map_fragment_offsets(static_cast<uint32_t>(offset));
+        }
+        proto_db.set_map_svg(std::move(map.svg));
+        proto_db.set_map_svg_gzip(gzip::Compress(proto_db.map_svg()));
+    }
+
+    void SerializeTiles(const transport::Catalogue& db, const renderer::MapRenderer& renderer, proto_transport::TransportCatalogue& proto_db) {
+        if (renderer.GetRenderSettings().tile_levels <= 0) {
+            return;
+        }
+        const auto& geometry = db.GetRouteGeometry();
+        const renderer::MapIndex index(geometry);
+        renderer::TilePyramid tiles = renderer::TilePyramid::Build(renderer, geometry, index, std::max(1u, std::thread::hardware_concurrency()));
+        for (const auto& svg : tiles.GetSvgs()) {
+            proto_db.add_tile_svgs(svg);
+        }
+        for (const auto& level : tiles.GetLevels()) {
+            auto& proto_level = *proto_db.add_tile_levels();
+            proto_level.mutable_tiles()->Add(level.begin(), level.end());
+        }
+    }
+
     proto_map::Point SerializePoint(const svg::Point& point) {
         proto_map::Point proto_point;
         proto_point.set_x(point.x);
@@ -210,9 +276,34 @@ namespace serialization {
         for (int i = 0; i < proto_render_settings.color_palette_size(); ++i) {
             render_settings.color_palette.push_back(DeserializeColor(proto_render_settings.color_palette(i)));
         }
+        render_settings.tile_levels = proto_render_settings.tile_levels();
+        render_settings.simplify_tolerance = proto_render_settings.simplify_tolerance();
+        render_settings.compact_svg = proto_render_settings.compact_svg();
+        if (proto_render_settings.number_format() < 0
+            || proto_render_settings.number_format() > static_cast<int32_t>(format::DoubleFormat::FIXED)) {
+            throw std::runtime_error("Error deserialized number format");
+        }
+        render_settings.number_style = { static_cast<format::DoubleFormat>(proto_render_settings.number_format()),
+            proto_render_settings.number_precision() };
+        if (proto_render_settings.tile_size() > 0) {
+            render_settings.tile_size = proto_render_settings.tile_size();
+        }
         return render_settings;
     }
 
+    renderer::TilePyramid DeserializeTiles(proto_transport::TransportCatalogue& proto_db) {
+        std::vector<std::string> svgs;
+        svgs.reserve(proto_db.tile_svgs_size());
+        for (auto& svg : *proto_db.mutable_tile_svgs()) {
+            svgs.push_back(std::move(svg));
+        }
+        std::vector<std::vector<uint32_t>> levels;
+        for (const auto& proto_level : proto_db.tile_levels()) {
+            levels.emplace_back(proto_level.tiles().begin(), proto_level.tiles().end());
+        }
+        return { std::move(svgs), std::move(levels) };
+    }
+
     svg::Point DeserializePoint(const proto_map::Point& proto_point) {
         return { proto_point.x(), proto_point.y() };
     }
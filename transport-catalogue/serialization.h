@@ -6,16 +6,25 @@
 #include "map_renderer.pb.h"
 #include "transport_catalogue.h"
 #include "request_handler.h"
+#include "snapshot.h"
+#include "map_tiles.h"
+
+#include <memory>
 
 namespace serialization {
 
+// Бросает std::runtime_error, если базу не удалось записать в out
 void Serialize(const transport::Catalogue& db, const renderer::MapRenderer& renderer, const transport::Router& router, std::ostream& out);
 std::tuple<transport::Catalogue, renderer::MapRenderer, transport::Router, graph::DirectedWeightedGraph<double>, std::map<std::string, graph::VertexId>> Deserialize(std::istream& input);
+std::tuple<transport::Catalogue, renderer::MapRenderer, transport::Router, graph::DirectedWeightedGraph<double>, std::map<std::string, graph::VertexId>> Deserialize(const proto_transport::TransportCatalogue& proto_db);
+std::shared_ptr<const transport::Snapshot> DeserializeSnapshot(std::istream& input, uint64_t version = 0);
 
 void SerializeStops(const transport::Catalogue& db, proto_transport::TransportCatalogue& proto_db);
 void SerializeStopDistances(const transport::Catalogue& db, proto_transport::TransportCatalogue& proto_db);
 void SerializeBuses(const transport::Catalogue& db, proto_transport::TransportCatalogue& proto_db);
 void SerializeRenderSettings(const renderer::MapRenderer& renderer, proto_transport::TransportCatalogue& proto_db);
+void SerializeMap(const transport::Catalogue& db, const renderer::MapRenderer& renderer, proto_transport::TransportCatalogue& proto_db);
+void SerializeTiles(const transport::Catalogue& db, const renderer::MapRenderer& renderer, proto_transport::TransportCatalogue& proto_db);
 proto_map::Point SerializePoint(const svg::Point& point);
 proto_map::Color SerializeColor(const svg::Color& color);
 proto_map::Rgb SerializeRgb(const svg::Rgb& rgb);
@@ -24,10 +33,13 @@ void SerializeRouter(const transport::Router& router, proto_transport::Transport
 proto_transport::RouterSettings SerializeRouterSettings(const transport::Router& router, proto_transport::TransportCatalogue& proto_db);
 proto_graph::Graph SerializeGraph(const transport::Router& router, proto_transport::TransportCatalogue& proto_db);
 
+proto_transport::TransportCatalogue ParseBase(std::istream& input);
 void DeserializeStops(transport::Catalogue& db, const proto_transport::TransportCatalogue& proto_db);
 void DeserializeStopDistances(transport::Catalogue& db, const proto_transport::TransportCatalogue& proto_db);
 void DeserializeBuses(transport::Catalogue& db, const proto_transport::TransportCatalogue& proto_db);
 renderer::MapRenderer DeserializeRenderSettings(renderer::RenderSettings& render_settings, const proto_transport::TransportCatalogue& proto_db);
+// Забирает тексты тайлов из proto_db, чтобы не копировать их
+renderer::TilePyramid DeserializeTiles(proto_transport::TransportCatalogue& proto_db);
 svg::Point DeserializePoint(const proto_map::Point& proto_point);
 svg::Color DeserializeColor(const proto_map::Color& proto_color);
 transport::Router DeserializeRouterSettings(const proto_transport::TransportCatalogue& proto_db);
@@ -0,0 +1,451 @@
+#include "server.h"
+#include "format.h"
+#include "serialization.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <cstring>
+#include <list>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace server {
+
+using namespace std::literals;
+
+Session::Session(const JsonReader& json_reader, transport::SnapshotStore& store)
+    : json_reader_(json_reader)
+    , store_(store)
+    , writer_(json_reader.GetNumberStyle(), json::Writer::Layout::COMPACT) {
+}
+
+std::string_view Session::Answer(std::string_view line) {
+    constexpr std::string_view spaces = " \t\r"sv;
+    if (line.find_first_not_of(spaces) == std::string_view::npos) {
+        return {};
+    }
+
+    writer_.Clear();
+    document_.Clear();
+    try {
+        json::Reader reader(line);
+        const json::FlatDict request_map = reader.ReadFlatNode(document_).AsDict();
+        if (reader.Rest().find_first_not_of(spaces) != std::string_view::npos) {
+            throw json::ParsingError("Unexpected characters after request"s);
+        }
+
+        if (const auto type = request_map.find("type"sv); type != request_map.end() && type->second.IsString()
+            && type->second.AsString() == "Update"sv) {
+            Update(request_map);
+            return writer_.GetBuffer();
+        }
+
+        // Версия базы закрепляется на время запроса: перезагрузка не затронет его ответ
+        const auto snapshot = store_.Pin();
+        const RequestHandler rh(*snapshot);
+        json_reader_.ProcessRequest(request_map, rh, writer_);
+
+        if (writer_.GetBuffer().empty()) {
+            writer_.BeginObject().Key("error_message"sv).String("unknown request type"sv);
+            if (const auto id = request_map.find("id"sv); id != request_map.end() && id->second.IsInt()) {
+                writer_.Key("request_id"sv).Int(id->second.AsInt());
+            }
+            writer_.EndObject();
+        }
+    }
+    catch (const std::exception& e) {
+        writer_.Clear();
+        writer_.BeginObject().Key("error_message"sv).String(e.what()).EndObject();
+    }
+    return writer_.GetBuffer();
+}
+
+void Session::Update(const json::FlatDict& request_map) {
+    const auto& base_requests = request_map.at("base_requests"sv);
+    // Ошибка в правках оставляет текущую версию нетронутой
+    const auto snapshot = store_.Update([this, &base_requests](transport::Catalogue& catalogue) {
+        return json_reader_.UpdateCatalogue(base_requests, catalogue);
+    });
+    writer_.BeginObject();
+    if (const auto id = request_map.find("id"sv); id != request_map.end() && id->second.IsInt()) {
+        writer_.Key("request_id"sv).Int(id->second.AsInt());
+    }
+    writer_.Key("version"sv).Int(static_cast<int>(snapshot->GetVersion())).EndObject();
+}
+
+namespace {
+
+// Резидентная память процесса в байтах, если система позволяет её узнать
+std::optional<long long> GetResidentMemory() {
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm"s);
+    long long total_pages = 0;
+    long long resident_pages = 0;
+    if (statm >> total_pages >> resident_pages) {
+        return resident_pages * sysconf(_SC_PAGESIZE);
+    }
+#endif
+    return std::nullopt;
+}
+
+std::string FormatMemory(std::optional<long long> bytes, bool with_sign = false) {
+    if (!bytes) {
+        return "unknown"s;
+    }
+    std::string result;
+    if (with_sign && *bytes >= 0) {
+        result += '+';
+    }
+    format::AppendDouble(result, static_cast<double>(*bytes) / (1024 * 1024), { format::DoubleFormat::FIXED, 1 });
+    result += " MiB"sv;
+    return result;
+}
+
+}  // namespace
+
+BaseReloader::BaseReloader(std::string base_file, std::ostream& log)
+    : base_file_(std::move(base_file))
+    , log_(log)
+    , store_(Load(1, current_)) {
+    log_ << "Base generation 1 loaded from "sv << base_file_ << " in "sv << current_.load_time.count() << " ms ("sv
+        << FormatMemory(current_.memory_delta, true) << "), resident "sv << FormatMemory(GetResidentMemory()) << std::endl;
+}
+
+BaseReloader::~BaseReloader() {
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    stop_cv_.notify_all();
+    if (watcher_.joinable()) {
+        watcher_.join();
+    }
+}
+
+transport::SnapshotStore& BaseReloader::GetStore() {
+    return store_;
+}
+
+void BaseReloader::Watch(std::chrono::milliseconds poll_interval) {
+    watcher_ = std::thread([this, poll_interval] {
+        std::unique_lock lock(mutex_);
+        while (!stop_cv_.wait_for(lock, poll_interval, [this] { return stop_; })) {
+            lock.unlock();
+            if (reload_requested_.exchange(false) || IsBaseChanged()) {
+                Reload();
+            }
+            ReportReleased();
+            lock.lock();
+        }
+    });
+}
+
+void BaseReloader::RequestReload() {
+    reload_requested_ = true;
+}
+
+std::shared_ptr<const transport::Snapshot> BaseReloader::Load(uint64_t number, Generation& generation, uint64_t version) {
+    // Время записи запоминается до чтения: повреждённый файл не перечитывается, пока его не заменят
+    std::error_code ec;
+    const auto write_time = std::filesystem::last_write_time(base_file_, ec);
+    base_write_time_ = ec ? std::nullopt : std::optional(write_time);
+
+    const auto memory_before = GetResidentMemory();
+    const auto start = std::chrono::steady_clock::now();
+    std::ifstream db_file(base_file_, std::ios::binary);
+    if (!db_file) {
+        throw std::runtime_error("Cannot open base file "s + base_file_);
+    }
+    auto snapshot = serialization::DeserializeSnapshot(db_file, version);
+    const auto memory_after = GetResidentMemory();
+
+    generation.number = number;
+    generation.snapshot = snapshot;
+    generation.load_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    generation.memory_delta = memory_before && memory_after ? std::optional(*memory_after - *memory_before) : std::nullopt;
+    return snapshot;
+}
+
+bool BaseReloader::IsBaseChanged() const {
+    std::error_code ec;
+    const auto write_time = std::filesystem::last_write_time(base_file_, ec);
+    return !ec && write_time != base_write_time_;
+}
+
+void BaseReloader::Reload() {
+    Generation next;
+    try {
+        // Перечитанная база продолжает нумерацию версий, в том числе после правок запросами Update
+        store_.Replace([this, &next](uint64_t version) {
+            return Load(current_.number + 1, next, version);
+        });
+    }
+    catch (const std::exception& e) {
+        log_ << "Base reload failed, generation "sv << current_.number << " stays current: "sv << e.what() << std::endl;
+        return;
+    }
+    log_ << "Base generation "sv << next.number << " loaded in "sv << next.load_time.count() << " ms ("sv
+        << FormatMemory(next.memory_delta, true) << "), resident "sv << FormatMemory(GetResidentMemory())
+        << "; generation "sv << current_.number << " was loaded in "sv << current_.load_time.count() << " ms ("sv
+        << FormatMemory(current_.memory_delta, true) << ")"sv << std::endl;
+    retired_.push_back(std::move(current_));
+    current_ = std::move(next);
+}
+
+void BaseReloader::ReportReleased() {
+    // Версия освобождается, когда завершается последний начатый на ней запрос
+    const auto released = std::stable_partition(retired_.begin(), retired_.end(), [](const Generation& generation) {
+        return !generation.snapshot.expired();
+    });
+    for (auto it = released; it != retired_.end(); ++it) {
+        log_ << "Base generation "sv << it->number << " released, resident "sv << FormatMemory(GetResidentMemory()) << std::endl;
+    }
+    retired_.erase(released, retired_.end());
+}
+
+void ServeStream(const JsonReader& json_reader, transport::SnapshotStore& store, std::istream& input, std::ostream& output) {
+    Session session(json_reader, store);
+    std::string line;
+    while (std::getline(input, line)) {
+        if (const std::string_view answer = session.Answer(line); !answer.empty()) {
+            output.write(answer.data(), static_cast<std::streamsize>(answer.size()));
+            output.put('\n');
+        }
+        // Пачка запросов, пришедшая одним куском, отвечается одной записью
+        if (input.rdbuf()->in_avail() <= 0) {
+            output.flush();
+        }
+    }
+    output.flush();
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+
+namespace {
+
+void ThrowSystemError(std::string_view what) {
+    throw std::runtime_error(std::string(what) + ": "s + std::strerror(errno));
+}
+
+bool SendAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+#ifdef MSG_NOSIGNAL
+        const ssize_t sent = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+#else
+        const ssize_t sent = send(fd, data.data(), data.size(), 0);
+#endif
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        data.remove_prefix(static_cast<size_t>(sent));
+    }
+    return true;
+}
+
+// Читает запросы до закрытия соединения клиентом или до остановки сервера. Ответы на все строки,
+// полученные одним read, отправляются одной записью. Строка длиннее MAX_REQUEST_BYTES получает
+// ответ с ошибкой, после чего соединение закрывается: иначе вход без перевода строки копился бы без предела
+void ServeConnection(const JsonReader& json_reader, transport::SnapshotStore& store, int fd) {
+    Session session(json_reader, store);
+    std::string input;
+    std::string output;
+    char chunk[64 * 1024];
+    for (bool is_open = true; is_open;) {
+        const ssize_t received = read(fd, chunk, sizeof(chunk));
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        is_open = received > 0;
+        // Перевод строки ищется только в новых данных, а не с начала недочитанной строки
+        size_t search_start = input.size();
+        if (is_open) {
+            input.append(chunk, static_cast<size_t>(received));
+        }
+        else if (!input.empty() && input.back() != '\n') {
+            // Последняя строка без перевода строки
+            input += '\n';
+        }
+
+        size_t line_start = 0;
+        for (size_t line_end = input.find('\n', search_start); line_end != std::string::npos; line_end = input.find('\n', line_start)) {
+            if (const std::string_view answer = session.Answer(std::string_view(input).substr(line_start, line_end - line_start));
+                !answer.empty()) {
+                output += answer;
+                output += '\n';
+            }
+            line_start = line_end + 1;
+        }
+        input.erase(0, line_start);
+
+        const bool is_too_long = input.size() > MAX_REQUEST_BYTES;
+        if (is_too_long) {
+            output += R"({"error_message":"request is too long"})"sv;
+            output += '\n';
+        }
+        if (!SendAll(fd, output) || is_too_long) {
+            break;
+        }
+        output.clear();
+    }
+}
+
+// Потоки обслуживаемых соединений. Завершившиеся потоки присоединяются при приёме следующего
+// соединения, остальные — в Stop. Поток закрывает сокет под тем же мьютексом, под которым
+// отмечает завершение, поэтому Stop не может задеть чужой дескриптор с тем же номером
+class Connections {
+public:
+    Connections() = default;
+    Connections(const Connections&) = delete;
+    Connections& operator=(const Connections&) = delete;
+
+    ~Connections() {
+        Stop();
+    }
+
+    template <typename Serve>
+    void Start(int fd, Serve serve) {
+        JoinFinished();
+        std::lock_guard lock(mutex_);
+        Connection& connection = connections_.emplace_back();
+        connection.fd = fd;
+        connection.thread = std::thread([this, &connection, serve] {
+            serve(connection.fd);
+            std::lock_guard lock(mutex_);
+            close(connection.fd);
+            connection.is_finished = true;
+        });
+    }
+
+    // Прекращает чтение во всех соединениях и дожидается их потоков.
+    // Уже полученные запросы дорабатываются, и ответы на них отправляются
+    void Stop() {
+        {
+            std::lock_guard lock(mutex_);
+            for (const Connection& connection : connections_) {
+                if (!connection.is_finished) {
+                    shutdown(connection.fd, SHUT_RD);
+                }
+            }
+        }
+        for (Connection& connection : connections_) {
+            connection.thread.join();
+        }
+        connections_.clear();
+    }
+
+private:
+    struct Connection {
+        int fd = -1;
+        std::thread thread;
+        bool is_finished = false;
+    };
+
+    std::mutex mutex_;
+    // Потоки ссылаются на свои элементы, поэтому элементы не должны перемещаться
+    std::list<Connection> connections_;
+
+    void JoinFinished() {
+        std::list<Connection> finished;
+        {
+            std::lock_guard lock(mutex_);
+            for (auto it = connections_.begin(); it != connections_.end();) {
+                const auto next = std::next(it);
+                if (it->is_finished) {
+                    finished.splice(finished.end(), connections_, it);
+                }
+                it = next;
+            }
+        }
+        for (Connection& connection : finished) {
+            connection.thread.join();
+        }
+    }
+};
+
+// Как часто цикл приёма соединений проверяет запрос на остановку
+constexpr int ACCEPT_POLL_MS = 200;
+
+std::atomic<bool> stop_requested = false;
+
+}  // namespace
+
+void StopServing() {
+    stop_requested = true;
+}
+
+void ServeSocket(const JsonReader& json_reader, transport::SnapshotStore& store, const std::string& socket_path) {
+    sockaddr_un address{};
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Socket path is too long: "s + socket_path);
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    const int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        ThrowSystemError("socket"sv);
+    }
+    unlink(socket_path.c_str());
+    if (bind(listen_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+        close(listen_fd);
+        ThrowSystemError("bind"sv);
+    }
+    if (listen(listen_fd, SOMAXCONN) < 0) {
+        close(listen_fd);
+        ThrowSystemError("listen"sv);
+    }
+
+    // Объявлены после проверок выше: при любом выходе из функции потоки соединений
+    // присоединяются раньше, чем json_reader и store могут быть разрушены
+    Connections connections;
+    while (!stop_requested) {
+        pollfd listen_poll{ listen_fd, POLLIN, 0 };
+        const int ready = poll(&listen_poll, 1, ACCEPT_POLL_MS);
+        if (ready < 0 && errno != EINTR) {
+            close(listen_fd);
+            ThrowSystemError("poll"sv);
+        }
+        if (ready <= 0) {
+            continue;
+        }
+        const int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED || errno == EAGAIN) {
+                continue;
+            }
+            close(listen_fd);
+            ThrowSystemError("accept"sv);
+        }
+        connections.Start(fd, [&json_reader, &store](int connection_fd) {
+            ServeConnection(json_reader, store, connection_fd);
+        });
+    }
+    close(listen_fd);
+    unlink(socket_path.c_str());
+    connections.Stop();
+}
+
+#else
+
+void StopServing() {
+}
+
+void ServeSocket(const JsonReader&, transport::SnapshotStore&, const std::string&) {
+    throw std::runtime_error("Unix domain sockets are not supported on this platform"s);
+}
+
+#endif
+
+}
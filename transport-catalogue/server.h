@@ -0,0 +1,121 @@
+#pragma once
+
+#include "json_flat.h"
+#include "json_reader.h"
+#include "json_writer.h"
+#include "snapshot.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace server {
+
+/*
+    * Сессия одного клиента режима serve. Запрос — словарь из stat_requests, записанный
+    * в одну строку, ответ — такой же словарь в одну строку. Каждый запрос выполняется
+    * на версии базы, текущей в момент его начала. Запрос Update с массивом base_requests
+    * правит базу в памяти, как update_base, и отвечает номером новой версии в "version". Арена разбора запроса и буфер ответа
+    * переиспользуются между запросами, поэтому сессию нельзя делить между потоками
+    */
+class Session {
+public:
+    Session(const JsonReader& json_reader, transport::SnapshotStore& store);
+
+    // Возвращает ответ без завершающего перевода строки, для пустой строки — пустой ответ.
+    // Ошибка разбора или неизвестный тип запроса превращаются в ответ с error_message
+    std::string_view Answer(std::string_view line);
+
+private:
+    const JsonReader& json_reader_;
+    transport::SnapshotStore& store_;
+    json::FlatDocument document_;
+    json::Writer writer_;
+
+    // Применяет правки запроса Update к текущей версии и публикует следующую
+    void Update(const json::FlatDict& request_map);
+};
+
+/*
+    * Владеет хранилищем версий базы режима serve и перезагружает файл базы без остановки
+    * обслуживания. Новая версия строится в фоновом потоке и подменяет текущую через
+    * SnapshotStore::Replace: новые запросы сразу идут к ней, а начатые дорабатывают на старой.
+    * Перезагрузка запускается вызовом RequestReload (например, из обработчика SIGHUP)
+    * или изменением времени записи файла. Если файл не читается, остаётся прежняя версия.
+    * Правки запросами Update в файл не пишутся и пропадают при следующей перезагрузке.
+    * О каждой загрузке и освобождении версии в log пишутся время загрузки и занятая процессом память
+    */
+class BaseReloader {
+public:
+    // Загружает первую версию базы. Бросает std::runtime_error, если файл не удалось прочитать
+    BaseReloader(std::string base_file, std::ostream& log);
+    BaseReloader(const BaseReloader&) = delete;
+    BaseReloader& operator=(const BaseReloader&) = delete;
+    ~BaseReloader();
+
+    transport::SnapshotStore& GetStore();
+
+    // Запускает фоновый поток, который раз в poll_interval проверяет запрос на перезагрузку и файл базы
+    void Watch(std::chrono::milliseconds poll_interval);
+
+    // Можно вызывать из обработчика сигнала
+    static void RequestReload();
+
+private:
+    struct Generation {
+        uint64_t number;
+        std::weak_ptr<const transport::Snapshot> snapshot;
+        std::chrono::milliseconds load_time;
+        // Прирост резидентной памяти процесса за время загрузки
+        std::optional<long long> memory_delta;
+    };
+
+    inline static std::atomic<bool> reload_requested_ = false;
+
+    std::string base_file_;
+    std::ostream& log_;
+    std::optional<std::filesystem::file_time_type> base_write_time_;
+    Generation current_;
+    // Заменённые версии, которые ещё используются начатыми запросами
+    std::vector<Generation> retired_;
+    transport::SnapshotStore store_;
+
+    std::thread watcher_;
+    std::mutex mutex_;
+    std::condition_variable stop_cv_;
+    bool stop_ = false;
+
+    // Читает файл базы как версию хранилища version и заполняет статистику generation
+    std::shared_ptr<const transport::Snapshot> Load(uint64_t number, Generation& generation, uint64_t version = 0);
+    bool IsBaseChanged() const;
+    void Reload();
+    void ReportReleased();
+};
+
+// Отвечает на запросы из input до конца потока. Вывод сбрасывается,
+// когда во входе не осталось уже прочитанных запросов
+void ServeStream(const JsonReader& json_reader, transport::SnapshotStore& store, std::istream& input, std::ostream& output);
+
+// Предел длины одного запроса на сокете; запрос Update несёт base_requests, поэтому предел с запасом
+inline constexpr size_t MAX_REQUEST_BYTES = size_t{ 16 } << 20;
+
+// Принимает соединения на Unix domain socket socket_path и обслуживает каждое в отдельном потоке.
+// Существующий файл сокета заменяется. Возвращает управление после StopServing, дождавшись
+// потоков всех соединений, или ошибкой std::runtime_error
+void ServeSocket(const JsonReader& json_reader, transport::SnapshotStore& store, const std::string& socket_path);
+
+// Останавливает ServeSocket: новые соединения не принимаются, а уже полученные запросы дорабатываются.
+// Можно вызывать из обработчика сигнала
+void StopServing();
+
+}
@@ -0,0 +1,150 @@
+#include "snapshot.h"
+#include "gzip_stream.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace transport {
+
+namespace {
+
+Catalogue Frozen(Catalogue catalogue) {
+    if (!catalogue.IsFrozen()) {
+        catalogue.Freeze();
+    }
+    return catalogue;
+}
+
+size_t ThreadsCount() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Одинаково ли рисуются карты двух версий: те же маршруты через те же остановки
+// с теми же названиями и координатами. Остановки вне маршрутов на карту не попадают
+bool HasSameMap(const RouteGeometry& lhs, const RouteGeometry& rhs) {
+    if (lhs.stops.size() != rhs.stops.size() || lhs.stop_on_route != rhs.stop_on_route
+        || lhs.bus_offsets != rhs.bus_offsets || lhs.bus_stop_ids != rhs.bus_stop_ids
+        || lhs.bus_is_circle != rhs.bus_is_circle || lhs.bus_color_ranks != rhs.bus_color_ranks) {
+        return false;
+    }
+    for (size_t bus = 0; bus < lhs.BusCount(); ++bus) {
+        if (lhs.buses[bus]->number != rhs.buses[bus]->number) {
+            return false;
+        }
+    }
+    for (size_t stop = 0; stop < lhs.stops.size(); ++stop) {
+        if (lhs.stop_on_route[stop] && (lhs.stop_lat[stop] != rhs.stop_lat[stop] || lhs.stop_lng[stop] != rhs.stop_lng[stop]
+            || lhs.stops[stop]->name != rhs.stops[stop]->name)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+Snapshot::Snapshot(Catalogue catalogue, renderer::MapRenderer renderer, Router router,
+    const graph::DirectedWeightedGraph<double>& graph, const std::map<std::string, graph::VertexId>& stop_ids,
+    std::string map_svg, renderer::TilePyramid tiles, uint64_t version, std::string map_svg_gzip)
+    : version_(version)
+    , catalogue_(Frozen(std::move(catalogue)))
+    , renderer_(std::move(renderer))
+    , router_(std::move(router))
+{
+    // Граф задаётся уже после перемещения маршрутизатора на его постоянное место
+    router_.SetGraph(graph, stop_ids);
+    MapLayers map;
+    if (map_svg.empty()) {
+        map.svg = renderer_.GetSVGText(catalogue_.GetRouteGeometry(), ThreadsCount());
+    }
+    else {
+        map.svg = std::move(map_svg);
+        map.svg_gzip = std::move(map_svg_gzip);
+    }
+    if (map.svg_gzip.empty()) {
+        map.svg_gzip = gzip::Compress(map.svg);
+    }
+    map.index = renderer::MapIndex(catalogue_.GetRouteGeometry());
+    map.tiles = std::move(tiles);
+    map_ = std::make_shared<const MapLayers>(std::move(map));
+}
+
+Snapshot::Snapshot(Catalogue catalogue, renderer::MapRenderer renderer, const Router& settings, uint64_t version)
+    : version_(version)
+    , catalogue_(Frozen(std::move(catalogue)))
+    , renderer_(std::move(renderer))
+    , router_(settings, catalogue_)
+    , map_(DrawMap())
+{
+}
+
+Snapshot::Snapshot(Catalogue catalogue, const Snapshot& previous, const std::set<std::string>& changed_buses)
+    : version_(previous.version_ + 1)
+    , catalogue_(Frozen(std::move(catalogue)))
+    , renderer_(previous.renderer_)
+    , router_(previous.router_.GetRouterSettings())
+    , map_(HasSameMap(catalogue_.GetRouteGeometry(), previous.catalogue_.GetRouteGeometry()) ? previous.map_ : DrawMap())
+{
+    // Рёбра неизменённых маршрутов переносятся из графа previous, матрица путей считается заново
+    Router updated = previous.router_.GetRouterSettings();
+    updated.UpdateGraph(catalogue_, previous.router_.GetGraph(), previous.router_.GetStopIds(), changed_buses);
+    router_.SetGraph(updated.GetGraph(), updated.GetStopIds());
+}
+
+std::shared_ptr<const Snapshot::MapLayers> Snapshot::DrawMap() const {
+    const auto& geometry = catalogue_.GetRouteGeometry();
+    auto map = std::make_shared<MapLayers>();
+    // Фрагменты, не изменившиеся с прошлой версии, берутся из кэша отрисовщика
+    map->svg = renderer_.GetSVGText(geometry, ThreadsCount());
+    map->svg_gzip = gzip::Compress(map->svg);
+    map->index = renderer::MapIndex(geometry);
+    map->tiles = renderer::TilePyramid::Build(renderer_, geometry, map->index, ThreadsCount());
+    return map;
+}
+
+const Catalogue& Snapshot::GetCatalogue() const {
+    return catalogue_;
+}
+
+const renderer::MapRenderer& Snapshot::GetRenderer() const {
+    return renderer_;
+}
+
+const Router& Snapshot::GetRouter() const {
+    return router_;
+}
+
+const std::string& Snapshot::GetMapSvg() const {
+    return map_->svg;
+}
+
+const std::string& Snapshot::GetMapSvgGzip() const {
+    return map_->svg_gzip;
+}
+
+const renderer::MapIndex& Snapshot::GetMapIndex() const {
+    return map_->index;
+}
+
+const renderer::TilePyramid& Snapshot::GetTiles() const {
+    return map_->tiles;
+}
+
+uint64_t Snapshot::GetVersion() const {
+    return version_;
+}
+
+SnapshotStore::SnapshotStore(std::shared_ptr<const Snapshot> snapshot)
+    : current_(std::move(snapshot))
+{
+}
+
+std::shared_ptr<const Snapshot> SnapshotStore::Pin() const {
+    return std::atomic_load(&current_);
+}
+
+void SnapshotStore::Publish(std::shared_ptr<const Snapshot> snapshot) {
+    std::atomic_store(&current_, std::move(snapshot));
+}
+
+}
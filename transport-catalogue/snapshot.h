@@ -0,0 +1,128 @@
+#pragma once
+
+#include "transport_catalogue.h"
+#include "map_renderer.h"
+#include "map_tiles.h"
+#include "transport_router.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+
+namespace transport {
+
+/*
+    * Неизменяемый снимок загруженной базы: справочник, отрисовщик карты и маршрутизатор.
+    * После создания снимок доступен только через константные ссылки, а константные методы
+    * Catalogue, MapRenderer и Router не меняют общего состояния (кэшей, буферов) и выделяют
+    * память только под собственные локальные результаты. Поэтому один снимок можно
+    * одновременно опрашивать из любого числа потоков без блокировок, например через
+    * RequestHandler, созданный в каждом потоке. Исключение — кэш фрагментов карты
+    * в MapRenderer::GetSVGText: он защищён мьютексом и нужен только при рисовании новой версии.
+    *
+    * Снимок не копируется и не перемещается, потому что маршрутизатор хранит ссылку
+    * на свой граф. Передавать его между потоками нужно через std::shared_ptr<const Snapshot>
+    */
+class Snapshot {
+public:
+    // Использует готовый граф маршрутизатора, готовую карту и тайлы, например десериализованные из базы.
+    // Пустая map_svg означает, что карту нужно нарисовать, пустая map_svg_gzip — сжать.
+    // Недостающие тайлы не дорисовываются
+    Snapshot(Catalogue catalogue, renderer::MapRenderer renderer, Router router,
+        const graph::DirectedWeightedGraph<double>& graph, const std::map<std::string, graph::VertexId>& stop_ids,
+        std::string map_svg = {}, renderer::TilePyramid tiles = {}, uint64_t version = 0, std::string map_svg_gzip = {});
+    // Строит граф маршрутизатора, рисует карту и тайлы по справочнику, из settings берутся только параметры маршрутизации
+    Snapshot(Catalogue catalogue, renderer::MapRenderer renderer, const Router& settings, uint64_t version = 0);
+    // Следующая версия previous после правки справочника. Граф маршрутизатора перестраивается
+    // только для маршрутов changed_buses, отрисовщик с кэшем фрагментов берётся из previous.
+    // Если линии и остановки маршрутов не изменились, карта, индекс и тайлы общие с previous
+    Snapshot(Catalogue catalogue, const Snapshot& previous, const std::set<std::string>& changed_buses);
+
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+
+    const Catalogue& GetCatalogue() const;
+    const renderer::MapRenderer& GetRenderer() const;
+    const Router& GetRouter() const;
+    // SVG-текст карты: он зависит только от снимка, поэтому рисуется один раз
+    const std::string& GetMapSvg() const;
+    // Та же карта, сжатая gzip один раз на снимок
+    const std::string& GetMapSvgGzip() const;
+    // Пространственный индекс для запросов Map с прямоугольником
+    const renderer::MapIndex& GetMapIndex() const;
+    const renderer::TilePyramid& GetTiles() const;
+    uint64_t GetVersion() const;
+
+private:
+    // Всё, что рисуется по линиям и остановкам маршрутов. Версии с одинаковой картой делят один экземпляр
+    struct MapLayers {
+        std::string svg;
+        std::string svg_gzip;
+        renderer::MapIndex index;
+        renderer::TilePyramid tiles;
+    };
+
+    uint64_t version_;
+    Catalogue catalogue_;
+    renderer::MapRenderer renderer_;
+    Router router_;
+    std::shared_ptr<const MapLayers> map_;
+
+    // Рисует карту и тайлы, строит индекс
+    std::shared_ptr<const MapLayers> DrawMap() const;
+};
+
+/*
+    * Версионированное хранилище снимков для правок базы на лету.
+    * Читатель закрепляет текущую версию вызовом Pin() и работает с ней сколько угодно долго,
+    * не блокируясь на обновлениях. Писатель строит следующую версию на копии справочника,
+    * которая разделяет с текущей все неизменённые остановки и маршруты, перестраивает
+    * рёбра графа изменённых маршрутов и атомарно подменяет текущую версию. Старая версия освобождается,
+    * когда её отпустит последний читатель
+    */
+class SnapshotStore {
+public:
+    explicit SnapshotStore(std::shared_ptr<const Snapshot> snapshot);
+
+    std::shared_ptr<const Snapshot> Pin() const;
+
+    // Делает текущей версией снимок, который возвращает load(version), например перечитанную из файла базу.
+    // version на единицу больше номера текущей версии, так что номера версий только растут.
+    // Ждёт завершения начатого Update, поэтому правка не может лечь поверх уже подменённой версии.
+    // Если load бросает исключение, текущая версия не меняется
+    template <typename Load>
+    std::shared_ptr<const Snapshot> Replace(Load load) {
+        std::lock_guard guard(writer_mutex_);
+        std::shared_ptr<const Snapshot> next = load(Pin()->GetVersion() + 1);
+        Publish(next);
+        return next;
+    }
+
+    // Применяет edit(Catalogue&) к копии справочника текущей версии и публикует результат.
+    // edit возвращает std::set<std::string> номеров маршрутов, чьи остановки или расстояния изменились,
+    // как JsonReader::UpdateCatalogue. Писатели выполняются по очереди, читатели при этом
+    // продолжают работать с прежней версией. Если edit бросает исключение, текущая версия не меняется
+    template <typename Edit>
+    std::shared_ptr<const Snapshot> Update(Edit edit) {
+        std::lock_guard guard(writer_mutex_);
+        const auto current = Pin();
+        Catalogue catalogue = current->GetCatalogue();
+        const std::set<std::string> changed_buses = edit(catalogue);
+        auto next = std::make_shared<const Snapshot>(std::move(catalogue), *current, changed_buses);
+        Publish(next);
+        return next;
+    }
+
+private:
+    std::shared_ptr<const Snapshot> current_;
+    // Писатели — Update и Replace — выполняются строго по очереди
+    std::mutex writer_mutex_;
+
+    // Атомарно делает snapshot текущей версией; вызывается под writer_mutex_
+    void Publish(std::shared_ptr<const Snapshot> snapshot);
+};
+
+}
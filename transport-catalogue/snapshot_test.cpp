@@ -0,0 +1,192 @@
+#include "request_handler.h"
+#include "snapshot.h"
+
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+// Небольшая сеть: кольцевой и некольцевой маршруты с общей пересадкой
+transport::Catalogue MakeCatalogue() {
+    transport::Catalogue catalogue;
+    catalogue.AddStop("Tolstopaltsevo"sv, { 55.611087, 37.20829 });
+    catalogue.AddStop("Marushkino"sv, { 55.595884, 37.209755 });
+    catalogue.AddStop("Rasskazovka"sv, { 55.632761, 37.333324 });
+    catalogue.AddStop("Biryulyovo Zapadnoye"sv, { 55.574371, 37.6517 });
+    catalogue.AddStop("Biryusinka"sv, { 55.581065, 37.64839 });
+    catalogue.AddStop("Universam"sv, { 55.587655, 37.645687 });
+    const auto stop = [&catalogue](std::string_view name) {
+        return catalogue.FindStop(name);
+    };
+    catalogue.SetDistance(stop("Tolstopaltsevo"sv), stop("Marushkino"sv), 3900);
+    catalogue.SetDistance(stop("Marushkino"sv), stop("Rasskazovka"sv), 9900);
+    catalogue.SetDistance(stop("Rasskazovka"sv), stop("Biryulyovo Zapadnoye"sv), 13000);
+    catalogue.SetDistance(stop("Biryulyovo Zapadnoye"sv), stop("Biryusinka"sv), 1800);
+    catalogue.SetDistance(stop("Biryusinka"sv), stop("Universam"sv), 750);
+    catalogue.SetDistance(stop("Universam"sv), stop("Biryulyovo Zapadnoye"sv), 2400);
+    catalogue.AddRoute("750"sv, { stop("Tolstopaltsevo"sv), stop("Marushkino"sv), stop("Rasskazovka"sv), stop("Biryulyovo Zapadnoye"sv) }, false);
+    catalogue.AddRoute("256"sv, { stop("Biryulyovo Zapadnoye"sv), stop("Biryusinka"sv), stop("Universam"sv), stop("Biryulyovo Zapadnoye"sv) }, true);
+    return catalogue;
+}
+
+renderer::MapRenderer MakeRenderer() {
+    renderer::RenderSettings settings;
+    settings.width = 600.0;
+    settings.height = 400.0;
+    settings.padding = 50.0;
+    settings.stop_radius = 5.0;
+    settings.line_width = 14.0;
+    settings.bus_label_font_size = 20;
+    settings.bus_label_offset = { 7.0, 15.0 };
+    settings.stop_label_font_size = 20;
+    settings.stop_label_offset = { 7.0, -3.0 };
+    settings.underlayer_color = svg::Rgba{ 255, 255, 255, 0.85 };
+    settings.underlayer_width = 3.0;
+    settings.color_palette = { "green"s, svg::Rgb{ 255, 160, 0 }, "red"s };
+    settings.tile_levels = 3;
+    return renderer::MapRenderer(settings);
+}
+
+std::shared_ptr<const transport::Snapshot> MakeSnapshot(transport::Catalogue catalogue) {
+    return std::make_shared<const transport::Snapshot>(std::move(catalogue), MakeRenderer(), transport::Router(6, 40.0));
+}
+
+std::string RenderText(const svg::Document& document) {
+    format::Buffer text;
+    document.Render(text);
+    return std::string(text.View());
+}
+
+// Ответы на все виды запросов к снимку одной строкой
+std::string QueryAll(const transport::Snapshot& snapshot) {
+    const RequestHandler rh(snapshot);
+    const std::vector<std::string_view> stops = { "Tolstopaltsevo"sv, "Marushkino"sv, "Rasskazovka"sv,
+        "Biryulyovo Zapadnoye"sv, "Biryusinka"sv, "Universam"sv };
+    std::string result;
+    for (const std::string_view bus : { "750"sv, "256"sv, "none"sv }) {
+        if (const auto stat = rh.GetBusStat(bus)) {
+            result += std::to_string(stat->stops_count) + ' ' + std::to_string(stat->unique_stops_count) + ' '
+                + std::to_string(stat->route_length) + ' ' + std::to_string(stat->curvature) + '\n';
+        }
+    }
+    for (const std::string_view from : stops) {
+        for (const auto& bus : rh.GetBusesByStop(from)) {
+            result += bus + ' ';
+        }
+        for (const std::string_view to : stops) {
+            if (const auto route = rh.GetOptimalRoute(from, to)) {
+                result += std::to_string(route->weight) + ' ' + std::to_string(route->edges.size()) + '\n';
+            }
+            if (const auto route_map = rh.RenderRouteMap(from, to)) {
+                result += RenderText(*route_map);
+            }
+        }
+    }
+    result += RenderText(rh.RenderMap());
+    result += rh.GetMapSvg();
+    result += rh.GetMapSvgGzip();
+    renderer::MapView view;
+    view.box = { { 55.58, 37.6 }, { 55.6, 37.66 } };
+    result += RenderText(rh.RenderMap(view));
+    for (int zoom = 0; zoom < 3; ++zoom) {
+        for (int x = 0; x < (1 << zoom); ++x) {
+            for (int y = 0; y < (1 << zoom); ++y) {
+                if (const std::string* tile = rh.GetTile(zoom, x, y)) {
+                    result += *tile;
+                }
+            }
+        }
+    }
+    return result;
+}
+
+// Версия, построенная SnapshotStore::Update по правке, отвечает так же, как снимок, построенный с нуля
+bool CheckUpdate(transport::SnapshotStore& store, std::string_view name, bool is_map_shared,
+    const std::function<std::set<std::string>(transport::Catalogue&)>& edit) {
+    const auto previous = store.Pin();
+    const std::string previous_answers = QueryAll(*previous);
+    const auto next = store.Update(edit);
+    if (next->GetVersion() != previous->GetVersion() + 1 || store.Pin() != next) {
+        std::cerr << name << ": the new version is not published\n"sv;
+        return false;
+    }
+    if ((&next->GetMapSvg() == &previous->GetMapSvg()) != is_map_shared) {
+        std::cerr << name << (is_map_shared ? ": the map is redrawn\n"sv : ": the map is not redrawn\n"sv);
+        return false;
+    }
+    // Правка копирует изменяемые остановки и маршруты, а не меняет их в прежней версии
+    if (QueryAll(*previous) != previous_answers) {
+        std::cerr << name << ": the edit changed the previous version\n"sv;
+        return false;
+    }
+    if (QueryAll(*next) != QueryAll(*MakeSnapshot(next->GetCatalogue()))) {
+        std::cerr << name << ": the updated version differs from the rebuilt one\n"sv;
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+// Опрашивает один снимок из нескольких потоков и сравнивает ответы с однопоточными,
+// затем проверяет правки через SnapshotStore.
+// Гонки данных ловит сборка с -DTRANSPORT_CATALOGUE_TSAN=ON
+int main() {
+    constexpr size_t threads_count = 8;
+    constexpr size_t rounds = 20;
+
+    const auto snapshot = MakeSnapshot(MakeCatalogue());
+    const std::string expected = QueryAll(*snapshot);
+
+    std::vector<std::string> results(threads_count);
+    std::vector<std::thread> threads;
+    threads.reserve(threads_count);
+    for (size_t i = 0; i < threads_count; ++i) {
+        threads.emplace_back([&snapshot, &result = results[i]] {
+            for (size_t round = 0; round < rounds; ++round) {
+                result = QueryAll(*snapshot);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (size_t i = 0; i < threads_count; ++i) {
+        if (results[i] != expected) {
+            std::cerr << "Thread "sv << i << " got a different answer\n"sv;
+            return 1;
+        }
+    }
+
+    transport::SnapshotStore store(snapshot);
+    // Новое расстояние меняет только граф, карта остаётся общей
+    const bool is_distance_updated = CheckUpdate(store, "distance"sv, true, [](transport::Catalogue& catalogue) {
+        catalogue.SetDistance(catalogue.FindStop("Biryusinka"sv), catalogue.FindStop("Universam"sv), 1000);
+        return std::set<std::string>{ "256"s };
+    });
+    // Сдвинутая остановка перерисовывает карту, но не меняет рёбер графа
+    const bool is_stop_moved = CheckUpdate(store, "coordinates"sv, false, [](transport::Catalogue& catalogue) {
+        catalogue.SetStopCoordinates("Universam"sv, { 55.59, 37.64 });
+        return std::set<std::string>{};
+    });
+    // Новый маршрут через новую остановку
+    const bool is_bus_added = CheckUpdate(store, "bus"sv, false, [](transport::Catalogue& catalogue) {
+        catalogue.AddStop("Prazhskaya"sv, { 55.61, 37.6 });
+        catalogue.SetDistance(catalogue.FindStop("Prazhskaya"sv), catalogue.FindStop("Universam"sv), 2500);
+        catalogue.AddRoute("14"sv, { catalogue.FindStop("Prazhskaya"sv), catalogue.FindStop("Universam"sv) }, false);
+        return std::set<std::string>{ "14"s };
+    });
+    if (!is_distance_updated || !is_stop_moved || !is_bus_added) {
+        return 1;
+    }
+    std::cout << "ok: "sv << threads_count << " threads, "sv << expected.size() << " bytes of answers, 3 updates\n"sv;
+    return 0;
+}
@@ -4,53 +4,72 @@ namespace svg {
 
 using namespace std::literals;
 
-std::ostream& operator<<(std::ostream& out, Color& color) {
-    std::visit(ColorPrinter{ out }, color);
-    return out;
-}
-std::ostream& operator<<(std::ostream& out, StrokeLineCap line_cap) {
+namespace {
+
+std::string_view LineCapName(StrokeLineCap line_cap) {
     switch (line_cap) {
     case StrokeLineCap::BUTT:
-        out << "butt"sv;
-        break;
+        return "butt"sv;
     case StrokeLineCap::ROUND:
-        out << "round"sv;
-        break;
+        return "round"sv;
     case StrokeLineCap::SQUARE:
-        out << "square"sv;
-        break;
+        return "square"sv;
     }
-    return out;
+    return {};
 }
 
-std::ostream& operator<<(std::ostream& out, StrokeLineJoin line_join) {
+std::string_view LineJoinName(StrokeLineJoin line_join) {
     switch (line_join) {
     case StrokeLineJoin::ARCS:
-        out << "arcs"sv;
-        break;
+        return "arcs"sv;
     case StrokeLineJoin::BEVEL:
-        out << "bevel"sv;
-        break;
+        return "bevel"sv;
     case StrokeLineJoin::MITER:
-        out << "miter"sv;
-        break;
+        return "miter"sv;
     case StrokeLineJoin::MITER_CLIP:
-        out << "miter-clip"sv;
-        break;
+        return "miter-clip"sv;
     case StrokeLineJoin::ROUND:
-        out << "round"sv;
-        break;
+        return "round"sv;
+    }
+    return {};
+}
+
+// Выводит фигуру из Document: для стандартных фигур тип известен при компиляции
+struct ObjectRenderer {
+    const RenderContext& context;
+
+    template <typename Shape>
+    void operator()(const Shape& shape) const {
+        shape.Render(context);
+    }
+
+    void operator()(const std::unique_ptr<Object>& object) const {
+        object->Render(context);
     }
-    return out;
+};
+
+}  // namespace
+
+std::ostream& operator<<(std::ostream& out, Color& color) {
+    format::Buffer buffer;
+    std::visit(ColorPrinter{ buffer }, color);
+    return out << buffer.View();
+}
+
+std::ostream& operator<<(std::ostream& out, StrokeLineCap line_cap) {
+    return out << LineCapName(line_cap);
 }
 
-void Object::Render(const RenderContext& context) const {
-    context.RenderIndent();
+std::ostream& operator<<(std::ostream& out, StrokeLineJoin line_join) {
+    return out << LineJoinName(line_join);
+}
 
-    // Делегируем вывод тега своим подклассам
-    RenderObject(context);
+format::Buffer& operator<<(format::Buffer& out, StrokeLineCap line_cap) {
+    return out << LineCapName(line_cap);
+}
 
-    context.out << std::endl;
+format::Buffer& operator<<(format::Buffer& out, StrokeLineJoin line_join) {
+    return out << LineJoinName(line_join);
 }
 
 // ---------- Circle ------------------
@@ -147,17 +166,70 @@ void Text::RenderObject(const RenderContext& context) const {
 
 // ---------- Document ----------------
 
+void Document::Add(Circle circle) {
+    objects_.emplace_back(std::move(circle));
+}
+
+void Document::Add(Polyline polyline) {
+    objects_.emplace_back(std::move(polyline));
+}
+
+void Document::Add(Text text) {
+    objects_.emplace_back(std::move(text));
+}
+
 void Document::AddPtr(std::unique_ptr<Object>&& obj) {
     objects_.emplace_back(std::move(obj));
 }
 
+void Document::Reserve(size_t objects_count) {
+    objects_.reserve(objects_count);
+}
+
+void Document::SetStyle(std::string style) {
+    style_ = std::move(style);
+}
+
+void Document::SetLayout(Layout layout) {
+    layout_ = layout;
+}
+
+void Document::SetNumberStyle(format::DoubleStyle style) {
+    number_style_ = style;
+}
+
 void Document::Render(std::ostream& out) const {
-    RenderContext ctx(out, 2, 2);
-    out << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>"sv << std::endl;
-    out << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">"sv << std::endl;
+    format::Buffer buffer;
+    Render(buffer);
+    out << buffer.View();
+}
+
+void Document::Render(format::Buffer& out) const {
+    RenderBegin(out);
+    const format::DoubleStyle out_style = out.GetDoubleStyle();
+    out.SetDoubleStyle(number_style_);
+    RenderContext ctx(out, 2, 2, layout_);
     for (const auto& obj : objects_) {
-        obj->Render(ctx);
+        std::visit(ObjectRenderer{ ctx }, obj);
+    }
+    out.SetDoubleStyle(out_style);
+    RenderEnd(out);
+}
+
+void Document::RenderBegin(format::Buffer& out) const {
+    RenderContext ctx(out, 2, 2, layout_);
+    out << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>"sv;
+    ctx.RenderNewLine();
+    out << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">"sv;
+    ctx.RenderNewLine();
+    if (!style_.empty()) {
+        ctx.RenderIndent();
+        out << "<style>"sv << style_ << "</style>"sv;
+        ctx.RenderNewLine();
     }
+}
+
+void Document::RenderEnd(format::Buffer& out) const {
     out << "</svg>"sv;
 }
 
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "format.h"
+
 #include <cstdint>
 #include <iostream>
 #include <memory>
@@ -53,7 +55,7 @@ inline const Color NoneColor{ std::monostate() };
 std::ostream& operator<<(std::ostream& out, Color& color);
 
 struct ColorPrinter {
-    std::ostream& out;
+    format::Buffer& out;
     void operator()(std::monostate) const { out << "none"; }
     void operator()(std::string color) const { out << color; }
     void operator()(Rgb color) const {
@@ -84,6 +86,8 @@ enum class StrokeLineJoin {
 
 std::ostream& operator<<(std::ostream& out, StrokeLineCap line_cap);
 std::ostream& operator<<(std::ostream& out, StrokeLineJoin line_join);
+format::Buffer& operator<<(format::Buffer& out, StrokeLineCap line_cap);
+format::Buffer& operator<<(format::Buffer& out, StrokeLineJoin line_join);
 
 struct Point {
     Point() = default;
@@ -95,34 +99,51 @@ struct Point {
     double y = 0;
 };
 
+// INDENTED выводит каждый элемент с новой строки с отступом, COMPACT — всё подряд без пробелов между тегами
+enum class Layout {
+    INDENTED,
+    COMPACT,
+};
+
 /*
     * Вспомогательная структура, хранящая контекст для вывода SVG-документа с отступами.
-    * Хранит ссылку на поток вывода, текущее значение и шаг отступа при выводе элемента
+    * Хранит ссылку на буфер вывода, текущее значение и шаг отступа при выводе элемента
     */
 struct RenderContext {
-    RenderContext(std::ostream& out)
+    RenderContext(format::Buffer& out)
         : out(out) {
     }
 
-    RenderContext(std::ostream& out, int indent_step, int indent = 0)
+    RenderContext(format::Buffer& out, int indent_step, int indent = 0, Layout layout = Layout::INDENTED)
         : out(out)
         , indent_step(indent_step)
-        , indent(indent) {
+        , indent(indent)
+        , layout(layout) {
     }
 
     RenderContext Indented() const {
-        return { out, indent_step, indent + indent_step };
+        return { out, indent_step, indent + indent_step, layout };
     }
 
     void RenderIndent() const {
+        if (layout == Layout::COMPACT) {
+            return;
+        }
         for (int i = 0; i < indent; ++i) {
-            out.put(' ');
+            out << ' ';
+        }
+    }
+
+    void RenderNewLine() const {
+        if (layout == Layout::INDENTED) {
+            out << '\n';
         }
     }
 
-    std::ostream& out;
+    format::Buffer& out;
     int indent_step = 0;
     int indent = 0;
+    Layout layout = Layout::INDENTED;
 };
 
 /*
@@ -132,7 +153,16 @@ struct RenderContext {
     */
 class Object {
 public:
-    void Render(const RenderContext& context) const;
+    // Определён в заголовке: при вызове для объекта известного конечного типа
+    // компилятор подставляет RenderObject без виртуального вызова
+    void Render(const RenderContext& context) const {
+        context.RenderIndent();
+
+        // Делегируем вывод тега своим подклассам
+        RenderObject(context);
+
+        context.RenderNewLine();
+    }
 
     virtual ~Object() = default;
 
@@ -197,13 +227,21 @@ public:
         line_join_ = line_join;
         return AsOwner();
     }
+    // Классы CSS из <style> документа (атрибут class): общие свойства не повторяются в каждом элементе
+    Owner& SetClass(std::string class_name) {
+        class_name_ = std::move(class_name);
+        return AsOwner();
+    }
 
 protected:
     ~PathProps() = default;
 
-    void RenderAttrs(std::ostream& out) const {
+    void RenderAttrs(format::Buffer& out) const {
         using namespace std::literals;
 
+        if (!class_name_.empty()) {
+            out << " class=\""sv << class_name_ << "\""sv;
+        }
         if (fill_color_) {
             out << " fill=\""sv;
             std::visit(ColorPrinter{ out }, *fill_color_);
@@ -237,6 +275,7 @@ private:
     std::optional<double> width_;
     std::optional<StrokeLineCap> line_cap_;
     std::optional<StrokeLineJoin> line_join_;
+    std::string class_name_;
 };
 
 
@@ -305,16 +344,47 @@ private:
     std::string data_;
 };
 
+/*
+    * Документ хранит фигуры в порядке добавления. Circle, Polyline и Text лежат в векторе
+    * по значению, без отдельного выделения памяти на каждую фигуру, и выводятся
+    * через std::visit без виртуальных вызовов. Прочие наследники svg::Object
+    * по-прежнему добавляются через AddPtr
+    */
 class Document : public ObjectContainer {
 public:
+    using ObjectContainer::Add;
+
+    void Add(Circle circle);
+    void Add(Polyline polyline);
+    void Add(Text text);
+
     // Добавляет в svg-документ объект-наследник svg::Object
     void AddPtr(std::unique_ptr<Object>&& obj) override;
 
+    // Резервирует место под objects_count фигур
+    void Reserve(size_t objects_count);
+
+    // Таблица стилей, которая выводится в <style> перед фигурами
+    void SetStyle(std::string style);
+    void SetLayout(Layout layout);
+    // Стиль чисел в координатах и размерах фигур; стиль буфера, в который выводится документ, не учитывается
+    void SetNumberStyle(format::DoubleStyle style);
+
     // Выводит в ostream svg-представление документа
     void Render(std::ostream& out) const;
+    // Дописывает svg-представление документа в буфер
+    void Render(format::Buffer& out) const;
+
+    // Заголовок со стилями и закрывающий тег: между ними можно вывести фигуры, отрисованные отдельно
+    // в контексте RenderContext(out, 2, 2, layout), и получить тот же текст, что и Render
+    void RenderBegin(format::Buffer& out) const;
+    void RenderEnd(format::Buffer& out) const;
 
 private:
-    std::vector<std::unique_ptr<Object>> objects_;
+    std::vector<std::variant<Circle, Polyline, Text, std::unique_ptr<Object>>> objects_;
+    std::string style_;
+    Layout layout_ = Layout::INDENTED;
+    format::DoubleStyle number_style_;
 };
 
 } // namespace svg
\ No newline at end of file
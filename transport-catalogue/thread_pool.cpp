@@ -0,0 +1,115 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+ThreadPool::ThreadPool(size_t threads_count) {
+    threads_count = std::max<size_t>(threads_count, 1);
+    queues_.reserve(threads_count);
+    for (size_t i = 0; i < threads_count; ++i) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    threads_.reserve(threads_count);
+    for (size_t i = 0; i < threads_count; ++i) {
+        threads_.emplace_back([this, i] {
+            WorkerLoop(i);
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    work_ready_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+size_t ThreadPool::GetThreadsCount() const {
+    return threads_.size();
+}
+
+void ThreadPool::Run(std::vector<std::function<void()>> tasks) {
+    if (tasks.empty()) {
+        return;
+    }
+    {
+        std::lock_guard lock(mutex_);
+        // Задачи раскладываются по очередям по кругу, соседние задачи попадают к разным потокам
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            auto& queue = *queues_[i % queues_.size()];
+            std::lock_guard queue_lock(queue.mutex);
+            queue.tasks.push_back(std::move(tasks[i]));
+        }
+        pending_ = tasks.size();
+        error_ = nullptr;
+        ++generation_;
+    }
+    work_ready_.notify_all();
+
+    std::unique_lock lock(mutex_);
+    work_done_.wait(lock, [this] {
+        return pending_ == 0;
+    });
+    if (error_) {
+        std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+}
+
+void ThreadPool::WorkerLoop(size_t index) {
+    uint64_t seen_generation = 0;
+    while (true) {
+        {
+            std::unique_lock lock(mutex_);
+            work_ready_.wait(lock, [this, seen_generation] {
+                return stop_ || generation_ != seen_generation;
+            });
+            if (stop_) {
+                return;
+            }
+            seen_generation = generation_;
+        }
+        std::function<void()> task;
+        while (TryPop(index, task)) {
+            std::exception_ptr error;
+            try {
+                task();
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+            std::lock_guard lock(mutex_);
+            if (error && !error_) {
+                error_ = error;
+            }
+            if (--pending_ == 0) {
+                work_done_.notify_all();
+            }
+        }
+    }
+}
+
+bool ThreadPool::TryPop(size_t index, std::function<void()>& task) {
+    {
+        auto& own = *queues_[index];
+        std::lock_guard lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t shift = 1; shift < queues_.size(); ++shift) {
+        auto& other = *queues_[(index + shift) % queues_.size()];
+        std::lock_guard lock(other.mutex);
+        if (!other.tasks.empty()) {
+            task = std::move(other.tasks.front());
+            other.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
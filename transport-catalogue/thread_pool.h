@@ -0,0 +1,49 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Пул потоков с отдельной очередью задач у каждого потока. Поток берёт задачи с конца
+// своей очереди, а когда она пустеет — забирает их из начала чужих очередей (work stealing),
+// поэтому тяжёлые задачи одного потока не задерживают остальные
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threads_count);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    size_t GetThreadsCount() const;
+
+    // Выполняет задачи и возвращает управление, когда все они завершены.
+    // Если задачи бросили исключения, пробрасывается первое из них
+    void Run(std::vector<std::function<void()>> tasks);
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+
+    std::mutex mutex_;
+    std::condition_variable work_ready_;
+    std::condition_variable work_done_;
+    // Номер текущего вызова Run: по нему потоки узнают о новых задачах
+    uint64_t generation_ = 0;
+    size_t pending_ = 0;
+    bool stop_ = false;
+    std::exception_ptr error_;
+
+    void WorkerLoop(size_t index);
+    bool TryPop(size_t index, std::function<void()>& task);
+};
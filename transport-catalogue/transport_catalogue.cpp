@@ -1,26 +1,45 @@
 #include "transport_catalogue.h"
 
+#include <algorithm>
+
 namespace transport {
     void Catalogue::AddStop(std::string_view stop_name, const geo::Coordinates& coordinates) {
-        all_stops_.push_back(Stop{ std::string(stop_name), coordinates, {} });
-        stopname_to_stop_[all_stops_.back().name] = &all_stops_.back();
+        if (FindStop(stop_name)) {
+            SetStopCoordinates(stop_name, coordinates);
+            return;
+        }
+        all_stops_.push_back(std::make_shared<Stop>(Stop{ std::string(stop_name), coordinates, {}, all_stops_.size() }));
+        const Stop* stop = all_stops_.back().get();
+        SetStopOwned(stop->id);
+        stopname_to_stop_[stop->name] = stop;
+        geometry_.stops.push_back(stop);
+        geometry_.stop_lat.push_back(coordinates.lat);
+        geometry_.stop_lng.push_back(coordinates.lng);
+        geometry_.stop_on_route.push_back(0);
+        stops_lat_trig_.Add(coordinates.lat);
+        frozen_ = false;
     }
 
     void Catalogue::AddRoute(std::string_view bus_number, const std::vector<const Stop*>& stops, bool is_circle) {
-        all_buses_.push_back(Bus{ std::string(bus_number), stops, is_circle });
-        busname_to_bus_[all_buses_.back().number] = &all_buses_.back();
+        std::string number(bus_number);
+        RemoveRoute(number);
+        auto bus = std::make_shared<Bus>(Bus{ std::move(number), stops, is_circle });
+        owned_.buses.insert(bus->number);
+        busname_to_bus_[bus->number] = bus;
         for (const auto* route_stop : stops) {
-            for (auto& stop : all_stops_) {
-                if (stop.name == route_stop->name) {
-                    stop.buses_by_stop.insert(std::string(bus_number));
-                }
-            }
+            MutableStop(route_stop->id).buses_by_stop.insert(bus->number);
+            geometry_.stop_on_route[route_stop->id] = 1;
+        }
+        // Переданные указатели могли устареть, если остановки были скопированы при правке
+        for (auto& route_stop : bus->stops) {
+            route_stop = all_stops_[route_stop->id].get();
         }
+        frozen_ = false;
     }
 
     const Bus* Catalogue::FindRoute(std::string_view bus_number) const {
         auto it = busname_to_bus_.find(bus_number);
-        return it != busname_to_bus_.end() ? it->second : nullptr;
+        return it != busname_to_bus_.end() ? it->second.get() : nullptr;
     }
 
     const Stop* Catalogue::FindStop(std::string_view stop_name) const {
@@ -28,6 +47,10 @@ namespace transport {
         return it != stopname_to_stop_.end() ? it->second : nullptr;
     }
 
+    const Stop* Catalogue::GetStop(size_t stop_id) const {
+        return stop_id < all_stops_.size() ? all_stops_[stop_id].get() : nullptr;
+    }
+
     size_t Catalogue::UniqueStopsCount(std::string_view bus_number) const {
         std::set<std::string_view> unique_stops;
         const auto* bus = FindRoute(bus_number);
@@ -41,23 +64,26 @@ namespace transport {
     }
 
     void Catalogue::SetDistance(const Stop* from, const Stop* to, const int distance) {
-        stop_distances_[{from, to}] = distance;
+        if (!from || !to) {
+            return;
+        }
+        MutableDistances()[{ from->id, to->id }] = distance;
     }
 
     int Catalogue::GetDistance(const Stop* from, const Stop* to) const {
-        auto it = stop_distances_.find({ from, to });
-        if (it != stop_distances_.end()) {
+        auto it = stop_distances_->find({ from->id, to->id });
+        if (it != stop_distances_->end()) {
             return it->second;
         } else {
-            it = stop_distances_.find({ to, from });
-            return it != stop_distances_.end() ? it->second : 0;
+            it = stop_distances_->find({ to->id, from->id });
+            return it != stop_distances_->end() ? it->second : 0;
         }
     }
 
     const std::map<std::string_view, const Bus*> Catalogue::GetSortedAllBuses() const {
         std::map<std::string_view, const Bus*> result;
         for (const auto& [bus_number, bus] : busname_to_bus_) {
-            result.emplace(bus_number, bus);
+            result.emplace(bus_number, bus.get());
         }
         return result;
     }
@@ -76,22 +102,38 @@ namespace transport {
         if (!bus) {
             return bus_stat;
         }
+        bus_stat.emplace();
+        // У маршрута без остановок нет перегонов: все показатели нулевые
+        if (bus->stops.empty()) {
+            return bus_stat;
+        }
         if (bus->is_circle) {
             (*bus_stat).stops_count = bus->stops.size();
         } else {
             (*bus_stat).stops_count = bus->stops.size() * 2 - 1;
         }
+        const size_t segments_count = bus->stops.size() - 1;
+        std::vector<size_t> from_ids(segments_count);
+        std::vector<size_t> to_ids(segments_count);
+        for (size_t i = 0; i < segments_count; ++i) {
+            from_ids[i] = bus->stops[i]->id;
+            to_ids[i] = bus->stops[i + 1]->id;
+        }
+        std::vector<double> segment_lengths(segments_count);
+        geo::ComputeDistances(stops_lat_trig_, geometry_.stop_lat.data(), geometry_.stop_lng.data(),
+            from_ids.data(), to_ids.data(), segments_count, segment_lengths.data());
+
         int route_length = 0;
         double geographic_length = 0.0;
-        for (auto it = bus->stops.begin(); it != bus->stops.end() - 1; ++it) {
-            const auto* from = *it;
-            const auto* to = *(it + 1);
+        for (size_t i = 0; i < segments_count; ++i) {
+            const auto* from = bus->stops[i];
+            const auto* to = bus->stops[i + 1];
             if (bus->is_circle) {
                 route_length += GetDistance(from, to);
-                geographic_length += geo::ComputeDistance(from->coordinates, to->coordinates);
+                geographic_length += segment_lengths[i];
             } else {
                 route_length += GetDistance(from, to) + GetDistance(to, from);
-                geographic_length += geo::ComputeDistance(from->coordinates, to->coordinates) * 2;
+                geographic_length += segment_lengths[i] * 2;
             }
         }
         (*bus_stat).unique_stops_count = UniqueStopsCount(bus_number);
@@ -100,7 +142,158 @@ namespace transport {
         return bus_stat;
     }
 
-    const std::unordered_map<std::pair<const Stop*, const Stop*>, int, Catalogue::StopDistancesHasher>& Catalogue::GetStopDistances() const {
-        return stop_distances_;
+    const Catalogue::StopDistances& Catalogue::GetStopDistances() const {
+        return *stop_distances_;
+    }
+
+    void Catalogue::SetStopCoordinates(std::string_view stop_name, const geo::Coordinates& coordinates) {
+        const Stop* stop = FindStop(stop_name);
+        if (!stop) {
+            throw std::logic_error("Unknown stop " + std::string(stop_name));
+        }
+        const size_t stop_id = stop->id;
+        MutableStop(stop_id).coordinates = coordinates;
+        geometry_.stop_lat[stop_id] = coordinates.lat;
+        geometry_.stop_lng[stop_id] = coordinates.lng;
+        stops_lat_trig_.Set(stop_id, coordinates.lat);
+        frozen_ = false;
+    }
+
+    void Catalogue::RemoveRoute(std::string_view bus_number) {
+        auto it = busname_to_bus_.find(bus_number);
+        if (it == busname_to_bus_.end()) {
+            return;
+        }
+        const std::string number = it->second->number;
+        std::vector<size_t> stop_ids;
+        for (const auto* stop : it->second->stops) {
+            stop_ids.push_back(stop->id);
+        }
+        for (const size_t stop_id : stop_ids) {
+            Stop& stop = MutableStop(stop_id);
+            stop.buses_by_stop.erase(number);
+            geometry_.stop_on_route[stop_id] = !stop.buses_by_stop.empty();
+        }
+        busname_to_bus_.erase(number);
+        owned_.buses.erase(number);
+        frozen_ = false;
+    }
+
+    void Catalogue::RemoveStop(std::string_view stop_name) {
+        const Stop* stop = FindStop(stop_name);
+        if (!stop) {
+            return;
+        }
+        if (!stop->buses_by_stop.empty()) {
+            throw std::logic_error("Stop " + stop->name + " is used by routes");
+        }
+        const size_t stop_id = stop->id;
+        auto& distances = MutableDistances();
+        for (auto it = distances.begin(); it != distances.end();) {
+            if (it->first.first == stop_id || it->first.second == stop_id) {
+                it = distances.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        stopname_to_stop_.erase(stop->name);
+        all_stops_[stop_id].reset();
+        geometry_.stops[stop_id] = nullptr;
+        geometry_.stop_on_route[stop_id] = 0;
+        frozen_ = false;
+    }
+
+    void Catalogue::RemoveDistance(const Stop* from, const Stop* to) {
+        if (!from || !to) {
+            return;
+        }
+        MutableDistances().erase({ from->id, to->id });
+    }
+
+    void Catalogue::SetStopOwned(size_t stop_id) {
+        if (owned_.stops.size() <= stop_id) {
+            owned_.stops.resize(stop_id + 1, 0);
+        }
+        owned_.stops[stop_id] = 1;
+    }
+
+    Stop& Catalogue::MutableStop(size_t stop_id) {
+        auto& stop = all_stops_[stop_id];
+        if (stop_id >= owned_.stops.size() || !owned_.stops[stop_id]) {
+            const Stop* shared_stop = stop.get();
+            stop = std::make_shared<Stop>(*shared_stop);
+            SetStopOwned(stop_id);
+            // Ключи индексов ссылаются на строки разделяемого объекта, поэтому их нужно пересоздать
+            stopname_to_stop_.erase(stop->name);
+            stopname_to_stop_.emplace(stop->name, stop.get());
+            geometry_.stops[stop_id] = stop.get();
+            for (const auto& bus_number : stop->buses_by_stop) {
+                Bus& bus = MutableBus(bus_number);
+                std::replace(bus.stops.begin(), bus.stops.end(), shared_stop, static_cast<const Stop*>(stop.get()));
+            }
+            frozen_ = false;
+        }
+        return *stop;
+    }
+
+    Bus& Catalogue::MutableBus(std::string_view bus_number) {
+        auto it = busname_to_bus_.find(bus_number);
+        if (!owned_.buses.count(it->second->number)) {
+            auto bus = std::make_shared<Bus>(*it->second);
+            owned_.buses.insert(bus->number);
+            busname_to_bus_.erase(it);
+            it = busname_to_bus_.emplace(bus->number, std::move(bus)).first;
+            frozen_ = false;
+        }
+        return *it->second;
+    }
+
+    Catalogue::StopDistances& Catalogue::MutableDistances() {
+        if (!owned_.distances) {
+            stop_distances_ = std::make_shared<StopDistances>(*stop_distances_);
+            owned_.distances = true;
+        }
+        return *stop_distances_;
+    }
+
+    void Catalogue::Freeze() {
+        const auto sorted_stops = GetSortedAllStops();
+        geometry_.sorted_stop_ids.clear();
+        geometry_.sorted_stop_ids.reserve(sorted_stops.size());
+        geometry_.stop_name_ranks.assign(geometry_.stops.size(), 0);
+        for (const auto& [stop_name, stop] : sorted_stops) {
+            geometry_.stop_name_ranks[stop->id] = geometry_.sorted_stop_ids.size();
+            geometry_.sorted_stop_ids.push_back(stop->id);
+        }
+
+        const auto sorted_buses = GetSortedAllBuses();
+        geometry_.buses.clear();
+        geometry_.bus_offsets.assign(1, 0);
+        geometry_.bus_stop_ids.clear();
+        geometry_.bus_is_circle.clear();
+        geometry_.bus_color_ranks.clear();
+        size_t routed_buses = 0;
+        for (const auto& [bus_number, bus] : sorted_buses) {
+            geometry_.bus_color_ranks.push_back(routed_buses);
+            if (!bus->stops.empty()) ++routed_buses;
+            geometry_.buses.push_back(bus);
+            for (const auto* stop : bus->stops) {
+                geometry_.bus_stop_ids.push_back(stop->id);
+            }
+            geometry_.bus_offsets.push_back(geometry_.bus_stop_ids.size());
+            geometry_.bus_is_circle.push_back(bus->is_circle);
+        }
+        frozen_ = true;
+    }
+
+    bool Catalogue::IsFrozen() const {
+        return frozen_;
+    }
+
+    const RouteGeometry& Catalogue::GetRouteGeometry() const {
+        if (!frozen_) {
+            throw std::logic_error("Catalogue is not frozen");
+        }
+        return geometry_;
     }
 }
\ No newline at end of file
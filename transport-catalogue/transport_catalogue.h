@@ -4,7 +4,7 @@
 #include "domain.h"
 
 #include <iostream>
-#include <deque>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -16,34 +16,91 @@
 
 namespace transport {
 
+// Справочник хранит остановки и маршруты в разделяемых объектах.
+// Копия справочника разделяет с оригиналом все Stop, Bus и таблицу расстояний и не владеет ни одним из них:
+// при первой правке объект копируется и дальше правится на месте (copy-on-write). Индексы — массив остановок,
+// словари названий и RouteGeometry — копируются целиком, поэтому память следующей версии растёт с размером сети,
+// хотя и без копий самих остановок и маршрутов. Оригинал после копирования не должен меняться:
+// так устроен SnapshotStore, который копирует справочник неизменяемого снимка
 class Catalogue {
 public:
+    using StopIdPair = std::pair<size_t, size_t>;
+
     struct StopDistancesHasher {
-        size_t operator()(const std::pair<const Stop*, const Stop*>& points) const {
-            size_t hash_first = std::hash<const void*>{}(points.first);
-            size_t hash_second = std::hash<const void*>{}(points.second);
+        size_t operator()(const StopIdPair& points) const {
+            size_t hash_first = std::hash<size_t>{}(points.first);
+            size_t hash_second = std::hash<size_t>{}(points.second);
             return hash_first + hash_second * 37;
         }
     };
+    using StopDistances = std::unordered_map<StopIdPair, int, StopDistancesHasher>;
 
     void AddStop(std::string_view stop_name, const geo::Coordinates& coordinates);
+    // Маршрут с уже существующим номером заменяется новым
     void AddRoute(std::string_view bus_number, const std::vector<const Stop*>& stops, bool is_circle);
     const Bus* FindRoute(std::string_view bus_number) const;
     const Stop* FindStop(std::string_view stop_name) const;
+    // Возвращает остановку по Stop::id или nullptr, если она удалена
+    const Stop* GetStop(size_t stop_id) const;
     size_t UniqueStopsCount(std::string_view bus_number) const;
     void SetDistance(const Stop* from, const Stop* to, const int distance);
     int GetDistance(const Stop* from, const Stop* to) const;
     const std::map<std::string_view, const Bus*> GetSortedAllBuses() const;
     const std::map<std::string_view, const Stop*> GetSortedAllStops() const;
     std::optional<transport::BusStat> GetBusStat(const std::string_view bus_number) const;
-    const std::unordered_map<std::pair<const Stop*, const Stop*>, int, StopDistancesHasher>& GetStopDistances() const;
+    const StopDistances& GetStopDistances() const;
+
+    void SetStopCoordinates(std::string_view stop_name, const geo::Coordinates& coordinates);
+    void RemoveRoute(std::string_view bus_number);
+    // Удаляет остановку и расстояния от неё и до неё. Остановку, через которую
+    // проходят маршруты, удалить нельзя: сначала нужно изменить или удалить эти маршруты
+    void RemoveStop(std::string_view stop_name);
+    void RemoveDistance(const Stop* from, const Stop* to);
+
+    // Строит SoA-представление маршрутов. Вызывается после загрузки всех остановок и маршрутов
+    void Freeze();
+    bool IsFrozen() const;
+    const RouteGeometry& GetRouteGeometry() const;
 
 private:
-    std::deque<Bus> all_buses_;
-    std::deque<Stop> all_stops_;
-    std::unordered_map<std::string_view, const Bus*> busname_to_bus_;
+    // Индекс — Stop::id, удалённые остановки хранятся как nullptr
+    std::vector<std::shared_ptr<Stop>> all_stops_;
+    std::unordered_map<std::string_view, std::shared_ptr<Bus>> busname_to_bus_;
     std::unordered_map<std::string_view, const Stop*> stopname_to_stop_;
-    std::unordered_map<std::pair<const Stop*, const Stop*>, int, StopDistancesHasher> stop_distances_;
+    std::shared_ptr<StopDistances> stop_distances_ = std::make_shared<StopDistances>();
+    // Массивы остановок geometry_ пополняются в AddStop, массивы маршрутов строит Freeze
+    RouteGeometry geometry_;
+    bool frozen_ = false;
+    // Кэш sin/cos широт остановок, индекс — Stop::id
+    geo::LatitudeTrigCache stops_lat_trig_;
+
+    // Объекты, которые создала или уже скопировала эта версия справочника: их можно править на месте.
+    // Копия справочника не владеет ничем, перемещённый справочник сохраняет владение
+    struct Ownership {
+        // Индекс — Stop::id
+        std::vector<uint8_t> stops;
+        std::unordered_set<std::string> buses;
+        bool distances = true;
+
+        Ownership() = default;
+        Ownership(const Ownership&)
+            : distances(false) {
+        }
+        Ownership& operator=(const Ownership&) {
+            stops.clear();
+            buses.clear();
+            distances = false;
+            return *this;
+        }
+        Ownership(Ownership&&) = default;
+        Ownership& operator=(Ownership&&) = default;
+    };
+    Ownership owned_;
+
+    void SetStopOwned(size_t stop_id);
+    Stop& MutableStop(size_t stop_id);
+    Bus& MutableBus(std::string_view bus_number);
+    StopDistances& MutableDistances();
 };
 
 }  // namespace transport
\ No newline at end of file
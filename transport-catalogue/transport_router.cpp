@@ -20,40 +20,94 @@ void Router::AddStopEdges(const Catalogue& catalogue, graph::DirectedWeightedGra
   }
 }
 
+std::vector<graph::VertexId> Router::GetStopVertices(const RouteGeometry& geometry, const std::map<std::string, graph::VertexId>& stop_ids) const {
+  std::vector<graph::VertexId> stop_vertices(geometry.stops.size());
+  for (size_t stop = 0; stop < geometry.stops.size(); ++stop) {
+    if (geometry.stops[stop]) {
+      stop_vertices[stop] = stop_ids.at(geometry.stops[stop]->name);
+    }
+  }
+  return stop_vertices;
+}
+
 void Router::AddBusEdges(const Catalogue& catalogue, graph::DirectedWeightedGraph<double>& graph, const std::map<std::string, graph::VertexId>& stop_ids) {
-  const auto& all_buses = catalogue.GetSortedAllBuses();
-  for_each(
-    all_buses.begin(),
-    all_buses.end(),
-    [&graph, this, &catalogue, &stop_ids](const auto& item) {
-      const auto& bus_info = item.second;
-      const auto& stops = bus_info->stops;
-      size_t stops_count = stops.size();
-      for (size_t i = 0; i < stops_count; ++i) {
-        for (size_t j = i + 1; j < stops_count; ++j) {
-          const Stop* stop_from = stops[i];
-          const Stop* stop_to = stops[j];
-          int dist_sum = 0;
-          int dist_sum_inverse = 0;
-          for (size_t k = i + 1; k <= j; ++k) {
-            dist_sum += catalogue.GetDistance(stops[k - 1], stops[k]);
-            dist_sum_inverse += catalogue.GetDistance(stops[k], stops[k - 1]);
-          }
-          graph.AddEdge({ bus_info->number,
-            j - i,
-            stop_ids.at(stop_from->name) + 1,
-            stop_ids.at(stop_to->name),
-            static_cast<double>(dist_sum) / (bus_velocity_ * (kDistanceFactor / kSpeedFactor))});
-          if (!bus_info->is_circle) {
-            graph.AddEdge({ bus_info->number,
-              j - i,
-              stop_ids.at(stop_to->name) + 1,
-              stop_ids.at(stop_from->name),
-              static_cast<double>(dist_sum_inverse) / (bus_velocity_ * (kDistanceFactor / kSpeedFactor))});
-          }
-        }
+  const auto& geometry = catalogue.GetRouteGeometry();
+  const auto stop_vertices = GetStopVertices(geometry, stop_ids);
+  for (size_t bus = 0; bus < geometry.BusCount(); ++bus) {
+    AddBusEdges(catalogue, graph, stop_vertices, bus);
+  }
+}
+
+void Router::AddBusEdges(const Catalogue& catalogue, graph::DirectedWeightedGraph<double>& graph, const std::vector<graph::VertexId>& stop_vertices, size_t bus) {
+  const auto& geometry = catalogue.GetRouteGeometry();
+  const double velocity = bus_velocity_ * (kDistanceFactor / kSpeedFactor);
+  const std::string& bus_number = geometry.buses[bus]->number;
+  const bool is_circle = geometry.bus_is_circle[bus];
+  const size_t* stops = geometry.BusStopsBegin(bus);
+  const size_t stops_count = geometry.BusStopsCount(bus);
+  for (size_t i = 0; i < stops_count; ++i) {
+    int dist_sum = 0;
+    int dist_sum_inverse = 0;
+    for (size_t j = i + 1; j < stops_count; ++j) {
+      const Stop* prev_stop = geometry.stops[stops[j - 1]];
+      const Stop* stop = geometry.stops[stops[j]];
+      dist_sum += catalogue.GetDistance(prev_stop, stop);
+      dist_sum_inverse += catalogue.GetDistance(stop, prev_stop);
+      graph.AddEdge({ bus_number,
+        j - i,
+        stop_vertices[stops[i]] + 1,
+        stop_vertices[stops[j]],
+        static_cast<double>(dist_sum) / velocity});
+      if (!is_circle) {
+        graph.AddEdge({ bus_number,
+          j - i,
+          stop_vertices[stops[j]] + 1,
+          stop_vertices[stops[i]],
+          static_cast<double>(dist_sum_inverse) / velocity});
       }
-    });
+    }
+  }
+}
+
+void Router::UpdateGraph(const Catalogue& catalogue, const graph::DirectedWeightedGraph<double>& previous_graph,
+    const std::map<std::string, graph::VertexId>& previous_stop_ids, const std::set<std::string>& changed_buses) {
+  // Старая вершина -> название остановки, чтобы перенумеровать перенесённые рёбра
+  std::vector<std::string_view> previous_vertex_stops(previous_graph.GetVertexCount());
+  for (const auto& [stop_name, vertex_id] : previous_stop_ids) {
+    previous_vertex_stops[vertex_id] = stop_name;
+    previous_vertex_stops[vertex_id + 1] = stop_name;
+  }
+  std::map<std::string_view, std::vector<graph::EdgeId>> previous_bus_edges;
+  for (graph::EdgeId edge_id = 0; edge_id < previous_graph.GetEdgeCount(); ++edge_id) {
+    const auto& edge = previous_graph.GetEdge(edge_id);
+    if (edge.quality > 0) {
+      previous_bus_edges[edge.name].push_back(edge_id);
+    }
+  }
+
+  const auto& geometry = catalogue.GetRouteGeometry();
+  graph::DirectedWeightedGraph<double> stops_graph(geometry.sorted_stop_ids.size() * 2);
+  std::map<std::string, graph::VertexId> stop_ids;
+  graph::VertexId vertex_id = 0;
+  AddStopEdges(catalogue, stops_graph, stop_ids, vertex_id);
+  const auto stop_vertices = GetStopVertices(geometry, stop_ids);
+  for (size_t bus = 0; bus < geometry.BusCount(); ++bus) {
+    const std::string& bus_number = geometry.buses[bus]->number;
+    const auto previous = previous_bus_edges.find(bus_number);
+    if (changed_buses.count(bus_number) || previous == previous_bus_edges.end()) {
+      AddBusEdges(catalogue, stops_graph, stop_vertices, bus);
+      continue;
+    }
+    for (const graph::EdgeId edge_id : previous->second) {
+      auto edge = previous_graph.GetEdge(edge_id);
+      edge.from = stop_ids.at(std::string(previous_vertex_stops[edge.from])) + edge.from % 2;
+      edge.to = stop_ids.at(std::string(previous_vertex_stops[edge.to])) + edge.to % 2;
+      stops_graph.AddEdge(edge);
+    }
+  }
+  stop_ids_ = std::move(stop_ids);
+  graph_ = std::move(stops_graph);
+  router_.reset();
 }
 
 void Router::BuildGraph(const Catalogue& catalogue) {
@@ -4,6 +4,9 @@
 #include "transport_catalogue.h"
 
 #include <memory>
+#include <set>
+#include <string>
+#include <vector>
 
 namespace transport {
 
@@ -35,6 +38,12 @@ public:
     const double GetBusVelocity() const;
     const Router GetRouterSettings() const;
     const std::map<std::string, graph::VertexId> GetStopIds() const;
+    // Перестраивает граф после правки справочника. Рёбра маршрутов, не вошедших в changed_buses,
+    // переносятся из previous_graph с перенумерацией вершин, остальные строятся заново.
+    // Результат совпадает с графом, построенным по справочнику с нуля. Матрица кратчайших
+    // путей не вычисляется: граф предназначен для сериализации или последующего SetGraph
+    void UpdateGraph(const Catalogue& catalogue, const graph::DirectedWeightedGraph<double>& previous_graph,
+        const std::map<std::string, graph::VertexId>& previous_stop_ids, const std::set<std::string>& changed_buses);
 
 	
 private:
@@ -48,6 +57,8 @@ private:
 	void BuildGraph(const Catalogue& catalogue);
 	void AddStopEdges(const Catalogue& catalogue, graph::DirectedWeightedGraph<double>& graph, std::map<std::string, graph::VertexId>& stop_ids, graph::VertexId& vertex_id);
 	void AddBusEdges(const Catalogue& catalogue, graph::DirectedWeightedGraph<double>& graph, const std::map<std::string, graph::VertexId>& stop_ids);
+	void AddBusEdges(const Catalogue& catalogue, graph::DirectedWeightedGraph<double>& graph, const std::vector<graph::VertexId>& stop_vertices, size_t bus);
+	std::vector<graph::VertexId> GetStopVertices(const RouteGeometry& geometry, const std::map<std::string, graph::VertexId>& stop_ids) const;
 
 };
 